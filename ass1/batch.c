@@ -0,0 +1,465 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include "push2310.h"
+
+#define MARGIN_BUCKETS 20
+
+//Settings for a batch of games played without printing. Games either
+//cycle through the loaded boards or, when there are none, each play on a
+//fresh board generated from the seed. Nothing here changes once the games
+//start, so the worker threads share it, and the tablebase if there is one,
+//without locking. recorder is the self-play record file, if any.
+typedef struct Batch {
+    const Strategy* strategy[2];
+    long games;
+    int threads;
+    int boards;
+    Game** boardList;
+    uint64_t seed;
+    Shape shape;
+    int maxScore;
+    Settings settings;
+    Tablebase* tablebase;
+    Recorder* recorder;
+} Batch;
+
+//Totals over the games played. Index 0 is player O and 1 is player X.
+//margins counts every O - X score difference, offset by maxScore.
+typedef struct Stats {
+    long games;
+    long moves;
+    long wins[2];
+    long draws;
+    long total[2];
+    int low[2];
+    int high[2];
+    long* margins;
+} Stats;
+
+//A thread of the game pool. A worker plays games from the front of its own
+//range [next, end) and, once that is empty, steals the back half of the
+//largest range left on another worker.
+typedef struct Worker {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    long next;
+    long end;
+    Stats stats;
+    Batch* batch;
+    struct Worker* pool;
+} Worker;
+
+//Return the wall clock time in seconds
+double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+//Load a save file and add it to the batch boards. The file name must
+//stay valid for the length of the batch. Files that can't be played are
+//reported and skipped.
+void add_board(Batch* batch, char* file) {
+    Game* board = calloc(1, sizeof(Game));
+    board->file = file;
+    Status status = read_file(board);
+    if(status == OK) {
+	status = is_board_full(board);
+    }
+    if(status != OK) {
+	fprintf(stderr, "%s: %s", file, status_message(status));
+	free(board->xBits);
+	free(board);
+	return;
+    }
+    init_turn(board);
+    batch->boardList = realloc(batch->boardList,
+	    sizeof(Game*) * (batch->boards + 1));
+    batch->boardList[batch->boards++] = board;
+    if(board->cells * 9 > batch->maxScore) {
+	batch->maxScore = board->cells * 9;
+    }
+}
+
+//Add every visible file in a directory to the batch boards in name order
+void add_directory(Batch* batch, char* dir) {
+    struct dirent** names;
+    struct stat info;
+    int count = scandir(dir, &names, NULL, alphasort);
+    if(count < 0) {
+	exit_status(BADFILE);
+    }
+    for(int i = 0; i < count; i++) {
+	if(names[i]->d_name[0] != '.') {
+	    char* file = malloc(strlen(dir) + strlen(names[i]->d_name) + 2);
+	    sprintf(file, "%s/%s", dir, names[i]->d_name);
+	    if(stat(file, &info) == 0 && S_ISREG(info.st_mode)) {
+		add_board(batch, file);
+	    } else {
+		free(file);
+	    }
+	}
+	free(names[i]);
+    }
+    free(names);
+}
+
+//Read a whole number argument greater than 0. Exit the batch with the
+//usage message if it is not valid.
+long batch_number(char* arg) {
+    char* err;
+    long number = strtol(arg, &err, 10);
+    if(*arg == '\0' || *err != '\0' || number < 1) {
+	exit_status(BATCHARGS);
+    }
+    return number;
+}
+
+//Check the batch arguments and load or describe the boards to play on.
+//  push2310 -b typeO typeX games [-t threads] [-l millis] [-m megabytes]
+//	    [-p playouts] [-D depth] [-j threads] [-B tablebase]
+//	    [-x records] (fname... | dir | -r seed height width)
+//The thread count defaults to the number of online processors. -x writes
+//every position played, the move played from it and the final scores to
+//a self-play record file.
+void check_batch_args(Batch* batch, int argc, char** argv) {
+    struct stat info;
+    int source = 5;
+    if(argc < 6) {
+	exit_status(BATCHARGS);
+    }
+    for(int i = 0; i < 2; i++) {
+	batch->strategy[i] = find_strategy(argv[2 + i]);
+	if(!batch->strategy[i] || batch->strategy[i]->type == 'H') {
+	    exit_status(BADPLAYER); //humans can't play a batch
+	}
+    }
+    batch->games = batch_number(argv[4]);
+    batch->threads = sysconf(_SC_NPROCESSORS_ONLN);
+    batch->settings = (Settings){DEFAULT_MILLIS, DEFAULT_MEGABYTES, 0, 1, 0,
+	    NULL};
+    while(source < argc) {
+	int used = read_setting(&batch->settings, argc, argv, source,
+		BATCHARGS);
+	if(!used && !strcmp(argv[source], "-t")) {
+	    if(argc < source + 3) {
+		exit_status(BATCHARGS);
+	    }
+	    batch->threads = batch_number(argv[source + 1]);
+	    used = 2;
+	} else if(!used && !strcmp(argv[source], "-x")) {
+	    if(argc < source + 3 || batch->recorder) {
+		exit_status(BATCHARGS);
+	    }
+	    if(!(batch->recorder = open_recorder(argv[source + 1]))) {
+		exit_status(BADRECORD);
+	    }
+	    used = 2;
+	}
+	if(!used) {
+	    break;
+	}
+	source += used;
+    }
+    if(source >= argc) {
+	exit_status(BATCHARGS);
+    }
+    if(batch->threads < 1) {
+	batch->threads = 1;
+    }
+    if(batch->settings.tablebase && !(batch->tablebase =
+	    open_tablebase(batch->settings.tablebase))) {
+	exit_status(BADTABLE);
+    }
+    if(!strcmp(argv[source], "-r")) {
+	if(argc != source + 4) {
+	    exit_status(BATCHARGS);
+	}
+	batch->seed = strtoull(argv[source + 1], NULL, 10);
+	batch->shape = (Shape){batch_number(argv[source + 2]),
+		batch_number(argv[source + 3]), 0, 9, 0};
+	if(batch->shape.height < 3 || batch->shape.width < 3) {
+	    exit_status(BATCHARGS);
+	}
+	batch->maxScore = batch->shape.height * batch->shape.width * 9;
+	return;
+    }
+    for(int i = source; i < argc; i++) {
+	if(stat(argv[i], &info) == 0 && S_ISDIR(info.st_mode)) {
+	    add_directory(batch, argv[i]);
+	} else {
+	    add_board(batch, argv[i]);
+	}
+    }
+    if(batch->boards == 0) {
+	exit_status(BADFILE);
+    }
+}
+
+//Set up the board for game number g of the batch
+void setup_game(Batch* batch, Game* game, long g) {
+    if(game->search) {
+	new_search_game(game->search);
+    }
+    if(batch->boards) {
+	copy_board(game, batch->boardList[g % batch->boards]);
+	return;
+    }
+    uint64_t state = batch->seed + g;
+    state = next_random(&state);
+    generate_board(game, &batch->shape, &state);
+    init_turn(game);
+}
+
+//Add the result of one game to the totals
+void add_result(Batch* batch, Stats* stats, Result* result) {
+    int scores[2] = {result->oScore, result->xScore};
+    int margin = result->oScore - result->xScore;
+    for(int i = 0; i < 2; i++) {
+	if(stats->games == 0 || scores[i] < stats->low[i]) {
+	    stats->low[i] = scores[i];
+	}
+	if(stats->games == 0 || scores[i] > stats->high[i]) {
+	    stats->high[i] = scores[i];
+	}
+	stats->total[i] += scores[i];
+    }
+    if(margin > 0) {
+	stats->wins[0]++;
+    } else if(margin < 0) {
+	stats->wins[1]++;
+    } else {
+	stats->draws++;
+    }
+    stats->margins[margin + batch->maxScore]++;
+    stats->moves += result->moves;
+    stats->games++;
+}
+
+//Add the totals of one worker to the batch totals
+void merge_stats(Batch* batch, Stats* total, Stats* part) {
+    if(part->games == 0) {
+	return;
+    }
+    for(int i = 0; i < 2; i++) {
+	if(total->games == 0 || part->low[i] < total->low[i]) {
+	    total->low[i] = part->low[i];
+	}
+	if(total->games == 0 || part->high[i] > total->high[i]) {
+	    total->high[i] = part->high[i];
+	}
+	total->wins[i] += part->wins[i];
+	total->total[i] += part->total[i];
+    }
+    for(int i = 0; i <= 2 * batch->maxScore; i++) {
+	total->margins[i] += part->margins[i];
+    }
+    total->draws += part->draws;
+    total->moves += part->moves;
+    total->games += part->games;
+}
+
+//Move the back half of the largest range left on another worker to the
+//thief. Return 0 once every other worker has run out of games.
+int steal_games(Worker* thief) {
+    Batch* batch = thief->batch;
+    while(1) {
+	Worker* victim = NULL;
+	long most = 0;
+	for(int i = 0; i < batch->threads; i++) {
+	    Worker* worker = &thief->pool[i];
+	    if(worker == thief) {
+		continue;
+	    }
+	    pthread_mutex_lock(&worker->lock);
+	    if(worker->end - worker->next > most) {
+		most = worker->end - worker->next;
+		victim = worker;
+	    }
+	    pthread_mutex_unlock(&worker->lock);
+	}
+	if(victim == NULL) {
+	    return 0;
+	}
+	pthread_mutex_lock(&victim->lock);
+	long left = victim->end - victim->next;
+	long end = victim->end;
+	victim->end -= (left + 1) / 2;
+	pthread_mutex_unlock(&victim->lock);
+	if(left > 0) { //the victim may have played them all since the scan
+	    pthread_mutex_lock(&thief->lock);
+	    thief->next = end - (left + 1) / 2;
+	    thief->end = end;
+	    pthread_mutex_unlock(&thief->lock);
+	    return 1;
+	}
+    }
+}
+
+//Return the number of the next game for the worker to play, stealing
+//more games when its own range is empty. Return -1 when there are none.
+long take_game(Worker* worker) {
+    while(1) {
+	long g = -1;
+	pthread_mutex_lock(&worker->lock);
+	if(worker->next < worker->end) {
+	    g = worker->next++;
+	}
+	pthread_mutex_unlock(&worker->lock);
+	if(g >= 0) {
+	    return g;
+	}
+	if(!steal_games(worker)) {
+	    return -1;
+	}
+    }
+}
+
+//Thread start routine. Play games until every range is empty, adding the
+//results to the worker's own totals.
+void* run_worker(void* arg) {
+    Worker* worker = arg;
+    Batch* batch = worker->batch;
+    Game* game = calloc(1, sizeof(Game));
+    for(int i = 0; i < 2; i++) {
+	game->strategy[i] = batch->strategy[i];
+	game->pType[i] = batch->strategy[i]->type;
+    }
+    game->tablebase = batch->tablebase;
+    if(game->pType[0] == '2' || game->pType[1] == '2') {
+	game->search = create_search(&batch->settings);
+    }
+    if(game->pType[0] == '3' || game->pType[1] == '3') {
+	game->mcts = create_mcts(&batch->settings);
+    }
+    Record* record = batch->recorder ? create_record(batch->recorder) : NULL;
+    long g;
+    while((g = take_game(worker)) >= 0) {
+	setup_game(batch, game, g);
+	Result result = record ? record_game(game, record) : play_game(game);
+	add_result(batch, &worker->stats, &result);
+    }
+    if(record) {
+	free_record(record);
+    }
+    if(game->search) {
+	free_search(game->search);
+    }
+    if(game->mcts) {
+	free_mcts(game->mcts);
+    }
+    free(game->xBits);
+    free(game);
+    return NULL;
+}
+
+//Play every game of the batch on a pool of worker threads. The games are
+//first split evenly between the workers. Every game's board depends only
+//on its number so the totals do not depend on the thread count.
+void run_games(Batch* batch, Stats* stats) {
+    if(batch->threads > batch->games) {
+	batch->threads = batch->games;
+    }
+    Worker* pool = calloc(batch->threads, sizeof(Worker));
+    for(int i = 0; i < batch->threads; i++) {
+	pool[i].batch = batch;
+	pool[i].pool = pool;
+	pool[i].next = batch->games * i / batch->threads;
+	pool[i].end = batch->games * (i + 1) / batch->threads;
+	pool[i].stats.margins = calloc(2 * batch->maxScore + 1, sizeof(long));
+	pthread_mutex_init(&pool[i].lock, NULL);
+    }
+    for(int i = 0; i < batch->threads; i++) {
+	pthread_create(&pool[i].thread, NULL, run_worker, &pool[i]);
+    }
+    for(int i = 0; i < batch->threads; i++) {
+	pthread_join(pool[i].thread, NULL);
+    }
+    //the locks are only destroyed once no worker can still be stealing
+    for(int i = 0; i < batch->threads; i++) {
+	merge_stats(batch, stats, &pool[i].stats);
+	pthread_mutex_destroy(&pool[i].lock);
+	free(pool[i].stats.margins);
+    }
+    free(pool);
+}
+
+//Print the spread of O - X score differences in at most MARGIN_BUCKETS
+//equal buckets covering the differences seen
+void print_margins(Batch* batch, Stats* stats) {
+    int low = 0;
+    int high = 2 * batch->maxScore;
+    while(!stats->margins[low]) {
+	low++;
+    }
+    while(!stats->margins[high]) {
+	high--;
+    }
+    int bucketSize = (high - low) / MARGIN_BUCKETS + 1;
+    printf("Margin (O - X):\n");
+    for(int i = low; i <= high; i += bucketSize) {
+	long count = 0;
+	for(int j = i; j < i + bucketSize && j <= high; j++) {
+	    count += stats->margins[j];
+	}
+	printf("  %5d to %5d: %ld\n", i - batch->maxScore,
+		i + bucketSize - 1 - batch->maxScore, count);
+    }
+}
+
+//Print the batch totals and how fast the games were played
+void print_stats(Batch* batch, Stats* stats, double seconds) {
+    const char names[2] = {'O', 'X'};
+    printf("Games: %ld", stats->games);
+    if(batch->boards) {
+	printf(" (%d boards)\n", batch->boards);
+    } else {
+	printf(" (random %dx%d boards)\n", batch->shape.height,
+		batch->shape.width);
+    }
+    for(int i = 0; i < 2; i++) {
+	printf("%c (type %c): wins %ld, score mean %.2f min %d max %d\n",
+		names[i], batch->strategy[i]->type, stats->wins[i],
+		(double)stats->total[i] / stats->games,
+		stats->low[i], stats->high[i]);
+    }
+    printf("Draws: %ld\n", stats->draws);
+    printf("Moves per game: %.2f\n", (double)stats->moves / stats->games);
+    print_margins(batch, stats);
+    if(batch->recorder) {
+	printf("Records: %ld positions\n", stats->moves);
+    }
+    printf("Threads: %d\n", batch->threads);
+    printf("Time: %.3fs, %.0f games/s\n", seconds,
+	    seconds > 0 ? stats->games / seconds : 0.0);
+}
+
+//Run a batch of games with no per move output and print the totals
+int run_batch(int argc, char** argv) {
+    Batch batch = {{0}};
+    Stats stats = {0};
+    check_batch_args(&batch, argc, argv);
+    stats.margins = calloc(2 * batch.maxScore + 1, sizeof(long));
+    double start = now();
+    run_games(&batch, &stats);
+    print_stats(&batch, &stats, now() - start);
+    for(int i = 0; i < batch.boards; i++) {
+	free(batch.boardList[i]->xBits);
+	free(batch.boardList[i]);
+    }
+    free(batch.boardList);
+    if(batch.recorder && !close_recorder(batch.recorder)) {
+	exit_status(BADRECORD);
+    }
+    if(batch.tablebase) {
+	close_tablebase(batch.tablebase);
+    }
+    free(stats.margins);
+    return OK;
+}
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "push2310.h"
+
+#define BINARY_VERSION 1
+#define HEADER_BYTES 14
+#define CHECK_BYTES 4
+
+//The binary save format. All numbers are little endian.
+//  bytes 0-3	    magic "P231"
+//  byte 4	    version
+//  byte 5	    player to move ('X' or 'O')
+//  bytes 6-9	    height
+//  bytes 10-13	    width
+//  then	    2 bits a cell for the piece, four cells a byte
+//  then	    4 bits a cell for the value, two cells a byte
+//  last 4 bytes    FNV-1a checksum of everything before it
+//Cells are in row major order from the low bits of each byte up.
+const char binaryMagic[4] = {'P', '2', '3', '1'};
+
+//Piece codes of the 2 bit cells. Corners hold no piece.
+const char pieceCodes[] = " .OX";
+
+//Return 1 if the file name ends in the binary save extension
+int is_binary_name(const char* fileName) {
+    size_t length = strlen(fileName);
+    return length > 4 && !strcmp(fileName + length - 4, ".bin");
+}
+
+//Return the FNV-1a hash of some bytes
+uint32_t checksum(const unsigned char* bytes, size_t length) {
+    uint32_t hash = 2166136261u;
+    for(size_t i = 0; i < length; i++) {
+	hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+//Write a number as 4 little endian bytes
+void put_word(unsigned char* out, uint32_t word) {
+    for(int i = 0; i < 4; i++) {
+	out[i] = word >> (i * 8);
+    }
+}
+
+//Read 4 little endian bytes as a number
+uint32_t get_word(const unsigned char* in) {
+    return in[0] | in[1] << 8 | in[2] << 16 | (uint32_t)in[3] << 24;
+}
+
+//Pack the pieces of the board 2 bits a cell, four cells a byte. The codes
+//are read straight off the bit planes: vacant is 1, O is 2 and X is 3.
+void pack_pieces(Game* game, unsigned char* out) {
+    memset(out, 0, (game->cells + 3) / 4);
+    for(int i = 0; i < game->cells; i++) {
+	int code = get_bit(game->emptyBits, i) | get_bit(game->oBits, i) << 1 |
+		get_bit(game->xBits, i) * 3;
+	out[i / 4] |= code << (i % 4 * 2);
+    }
+}
+
+//Pack the values of the board 4 bits a cell, two cells a byte
+void pack_values(Game* game, unsigned char* out) {
+    memset(out, 0, (game->cells + 1) / 2);
+    for(int i = 0; i < game->cells; i++) {
+	out[i / 2] |= game->values[i] << (i % 2 * 4);
+    }
+}
+
+//Return the size of a binary save of a board with the given number of
+//cells
+size_t binary_bytes(size_t cells) {
+    return HEADER_BYTES + (cells + 3) / 4 + (cells + 1) / 2 + CHECK_BYTES;
+}
+
+//Save the game in the binary format with a single write. Return 0 if the
+//file can't be written.
+int save_binary(Game* game, const char* fileName) {
+    size_t size = binary_bytes(game->cells);
+    unsigned char* out = calloc(size, 1);
+    unsigned char* pieces = out + HEADER_BYTES;
+    unsigned char* values = pieces + (game->cells + 3) / 4;
+    memcpy(out, binaryMagic, 4);
+    out[4] = BINARY_VERSION;
+    out[5] = game->players[game->turn];
+    put_word(out + 6, game->height);
+    put_word(out + 10, game->width);
+    pack_pieces(game, pieces);
+    pack_values(game, values);
+    put_word(out + size - CHECK_BYTES, checksum(out, size - CHECK_BYTES));
+    FILE* fileSave = fopen(fileName, "w");
+    int written = 0;
+    if(fileSave != NULL) {
+	written = fwrite(out, size, 1, fileSave) == 1;
+	written &= fclose(fileSave) == 0;
+    }
+    free(out);
+    return written;
+}
+
+//Return 1 if the contents of a file start like a binary save
+int is_binary_save(const char* contents, size_t size) {
+    return size >= 4 && !memcmp(contents, binaryMagic, 4);
+}
+
+//Load a board from the contents of a binary save. Return BADSAVE if the
+//header, size or checksum is wrong or a cell is not valid.
+Status load_binary(Game* game, const char* contents, size_t size) {
+    const unsigned char* in = (const unsigned char*)contents;
+    if(size < HEADER_BYTES + CHECK_BYTES || in[4] != BINARY_VERSION) {
+	return BADSAVE;
+    }
+    uint32_t height = get_word(in + 6);
+    uint32_t width = get_word(in + 10);
+    if(height < 3 || width < 3 || height > INT32_MAX / width ||
+	    size != binary_bytes((size_t)height * width) ||
+	    get_word(in + size - CHECK_BYTES) !=
+	    checksum(in, size - CHECK_BYTES)) {
+	return BADSAVE;
+    }
+    game->p1 = in[5];
+    if(!(game->p1 == 'X' || game->p1 == 'O')) {
+	return BADSAVE;
+    }
+    game->height = height;
+    game->width = width;
+    create_board(game);
+    const unsigned char* pieces = in + HEADER_BYTES;
+    const unsigned char* values = pieces + (game->cells + 3) / 4;
+    for(int i = 0; i < game->cells; i++) {
+	char piece = pieceCodes[(pieces[i / 4] >> (i % 4 * 2)) & 3];
+	int value = (values[i / 2] >> (i % 2 * 4)) & 15;
+	int corner = is_corner(game, i / game->width, i % game->width);
+	if(value > 9 || corner != (piece == ' ') || (corner && value)) {
+	    return BADSAVE;
+	}
+	if(!corner) {
+	    game->values[i] = value;
+	    put_piece(game, i, piece);
+	}
+    }
+    return OK;
+}
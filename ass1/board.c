@@ -0,0 +1,797 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "push2310.h"
+
+//Return 1 if bit i of the plane is set else 0
+int get_bit(const uint64_t* bits, int i) {
+    return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+//Set bit i of the plane
+void set_bit(uint64_t* bits, int i) {
+    bits[i >> 6] |= (uint64_t)1 << (i & 63);
+}
+
+//Clear bit i of the plane
+void clear_bit(uint64_t* bits, int i) {
+    bits[i >> 6] &= ~((uint64_t)1 << (i & 63));
+}
+
+//Return the mask of the bits in word w of a plane that fall in [start, end)
+uint64_t range_mask(int w, int start, int end) {
+    int from = start - w * 64;
+    int to = end - w * 64;
+    if(from < 0) {
+	from = 0;
+    }
+    if(to > 64) {
+	to = 64;
+    }
+    if(from >= to) {
+	return 0;
+    }
+    uint64_t mask = (to == 64) ? ~(uint64_t)0 : ((uint64_t)1 << to) - 1;
+    return mask & (~(uint64_t)0 << from);
+}
+
+//Return the index of the lowest set bit of the plane in [start, end),
+//or -1 if there is none
+int first_bit(const uint64_t* bits, int start, int end) {
+    if(start >= end) {
+	return -1;
+    }
+    for(int w = start >> 6; w <= (end - 1) >> 6; w++) {
+	uint64_t word = bits[w] & range_mask(w, start, end);
+	if(word) {
+	    return w * 64 + __builtin_ctzll(word);
+	}
+    }
+    return -1;
+}
+
+//Return the index of the highest set bit of the plane in [start, end),
+//or -1 if there is none
+int last_bit(const uint64_t* bits, int start, int end) {
+    if(start >= end) {
+	return -1;
+    }
+    for(int w = (end - 1) >> 6; w >= start >> 6; w--) {
+	uint64_t word = bits[w] & range_mask(w, start, end);
+	if(word) {
+	    return w * 64 + 63 - __builtin_clzll(word);
+	}
+    }
+    return -1;
+}
+
+//Move the bits of a plane in [start, end) up one place to [start + 1, end]
+//and clear bit start. Words are done from the top down so a carry is read
+//before the word below is rewritten.
+void shift_up(uint64_t* bits, int start, int end) {
+    for(int w = end >> 6; w >= start >> 6; w--) {
+	uint64_t carry = (w * 64 > start) ? bits[w - 1] >> 63 : 0;
+	uint64_t mask = range_mask(w, start + 1, end + 1);
+	bits[w] = (bits[w] & ~mask) | (((bits[w] << 1) | carry) & mask);
+    }
+    clear_bit(bits, start);
+}
+
+//Move the bits of a plane in (start, end] down one place to [start, end)
+//and clear bit end. Words are done from the bottom up.
+void shift_down(uint64_t* bits, int start, int end) {
+    for(int w = start >> 6; w <= end >> 6; w++) {
+	uint64_t carry = ((w + 1) * 64 <= end) ? bits[w + 1] << 63 : 0;
+	uint64_t mask = range_mask(w, start, end);
+	bits[w] = (bits[w] & ~mask) | (((bits[w] >> 1) | carry) & mask);
+    }
+    clear_bit(bits, end);
+}
+
+//Return the Zobrist key of a piece ('X' or 'O') in cell i. Keys are made
+//from the cell and piece on demand so boards of any size can be hashed
+//without a key table.
+uint64_t cell_key(int i, char piece) {
+    uint64_t state = (uint64_t)i * 2 + (piece == 'X');
+    return next_random(&state);
+}
+
+//Take the pieces in cells [start, end) out of the scores and the hash when
+//sign is -1, or put them back in when it is 1
+void count_range(Game* game, int start, int end, int sign) {
+    uint64_t* planes[2] = {game->xBits, game->oBits};
+    int* scores[2] = {&game->xScore, &game->oScore};
+    for(int p = 0; p < 2; p++) {
+	for(int w = start >> 6; w <= (end - 1) >> 6; w++) {
+	    uint64_t word = planes[p][w] & range_mask(w, start, end);
+	    while(word) {
+		int i = w * 64 + __builtin_ctzll(word);
+		*scores[p] += sign * game->values[i];
+		game->hash ^= cell_key(i, p ? 'O' : 'X');
+		word &= word - 1;
+	    }
+	}
+    }
+}
+
+//Create the game board bit planes, counts and value array. Everything is
+//held in a single allocation so a board can be copied with one memcpy.
+//Save board to struct. Exit with the bad save status if there is no
+//memory for it.
+void create_board(Game* game) {
+    game->cells = game->height * game->width;
+    game->words = (game->cells + 63) / 64;
+    game->xBits = calloc(1, board_bytes(game));
+    if(game->xBits == NULL) {
+	exit_status(BADSAVE);
+    }
+    game->oBits = game->xBits + game->words;
+    game->emptyBits = game->oBits + game->words;
+    game->emptyCols = game->emptyBits + game->words;
+    game->legalBits = game->emptyCols + game->words;
+    game->interior = game->legalBits + game->words;
+    game->rowEmpty = (int*)(game->interior + game->words);
+    game->colEmpty = game->rowEmpty + game->height;
+    game->values = (unsigned char*)(game->interior + game->words +
+	    (game->height + game->width + 1) / 2);
+    game->xScore = 0;
+    game->oScore = 0;
+    game->emptyInterior = 0;
+    game->hash = 0;
+    game->layout = 0;
+    for(int i = 1; i < game->height - 1; i++) {
+	for(int j = 1; j < game->width - 1; j++) {
+	    set_bit(game->interior, i * game->width + j);
+	}
+    }
+}
+
+//Return the number of bytes used by the board planes, counts and values
+size_t board_bytes(Game* game) {
+    return (game->words * 6 + (game->height + game->width + 1) / 2 +
+	    (game->cells + 7) / 8) * sizeof(uint64_t);
+}
+
+//Make sure the game has a board of the given size, reusing the current
+//allocation when the size has not changed
+void size_board(Game* game, int height, int width) {
+    if(game->xBits != NULL && game->height == height &&
+	    game->width == width) {
+	return;
+    }
+    free(game->xBits);
+    game->height = height;
+    game->width = width;
+    create_board(game);
+}
+
+//Copy the board and turn of one game into another
+void copy_board(Game* dest, Game* src) {
+    size_board(dest, src->height, src->width);
+    memcpy(dest->xBits, src->xBits, board_bytes(src));
+    dest->xScore = src->xScore;
+    dest->oScore = src->oScore;
+    dest->emptyInterior = src->emptyInterior;
+    dest->hash = src->hash;
+    dest->layout = src->layout;
+    dest->turn = src->turn;
+    dest->p1 = src->p1;
+    dest->p2 = src->p2;
+    dest->players[0] = src->players[0];
+    dest->players[1] = src->players[1];
+}
+
+//Return the next number from a splitmix64 generator
+uint64_t next_random(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+//Return 1 if the cell is one of the four board corners
+int is_corner(Game* game, int row, int col) {
+    return (row == 0 || row == game->height - 1) &&
+	    (col == 0 || col == game->width - 1);
+}
+
+//Work out again whether a piece may be placed in a cell
+void update_legal(Game* game, int row, int col) {
+    int i = row * game->width + col;
+    if(can_place(game, row, col) && can_push(game, row, col)) {
+	set_bit(game->legalBits, i);
+    } else {
+	clear_bit(game->legalBits, i);
+    }
+}
+
+//Make cell i vacant or not, keeping the column plane, the row and column
+//counts, the count of vacant interior cells and the legal moves in step.
+//Whether a cell is a legal move only depends on which cells of its row or
+//column are vacant, so at most five cells need to be looked at again: the
+//cell itself and the edge cells at the ends of its row and column.
+void set_vacant(Game* game, int i, int vacant) {
+    int height = game->height;
+    int width = game->width;
+    int row = i / width;
+    int col = i % width;
+    if(get_bit(game->emptyBits, i) == vacant) {
+	return;
+    }
+    int change = vacant ? 1 : -1;
+    if(vacant) {
+	set_bit(game->emptyBits, i);
+	set_bit(game->emptyCols, col * height + row);
+    } else {
+	clear_bit(game->emptyBits, i);
+	clear_bit(game->emptyCols, col * height + row);
+    }
+    game->rowEmpty[row] += change;
+    game->colEmpty[col] += change;
+    game->emptyInterior += change * get_bit(game->interior, i);
+    update_legal(game, row, col);
+    if(col > 0 && col < width - 1) {
+	update_legal(game, 0, col);
+	update_legal(game, height - 1, col);
+    }
+    if(row > 0 && row < height - 1) {
+	update_legal(game, row, 0);
+	update_legal(game, row, width - 1);
+    }
+}
+
+//Put a piece ('X', 'O' or '.') in cell i, keeping every plane, the
+//scores, the hash and the counts of vacant cells in step
+void put_piece(Game* game, int i, char piece) {
+    if(get_bit(game->xBits, i)) {
+	game->xScore -= game->values[i];
+	game->hash ^= cell_key(i, 'X');
+    } else if(get_bit(game->oBits, i)) {
+	game->oScore -= game->values[i];
+	game->hash ^= cell_key(i, 'O');
+    }
+    clear_bit(game->xBits, i);
+    clear_bit(game->oBits, i);
+    if(piece == 'X') {
+	set_bit(game->xBits, i);
+	game->xScore += game->values[i];
+	game->hash ^= cell_key(i, 'X');
+    } else if(piece == 'O') {
+	set_bit(game->oBits, i);
+	game->oScore += game->values[i];
+	game->hash ^= cell_key(i, 'O');
+    }
+    set_vacant(game, i, piece == '.');
+}
+
+//Return the piece in cell i as it appears in a save file
+char piece_at(Game* game, int i) {
+    if(get_bit(game->xBits, i)) {
+	return 'X';
+    }
+    if(get_bit(game->oBits, i)) {
+	return 'O';
+    }
+    if(get_bit(game->emptyBits, i)) {
+	return '.';
+    }
+    return ' ';
+}
+
+//Return the piece in a cell as it appears in a save file
+char get_piece(Game* game, int row, int col) {
+    return piece_at(game, row * game->width + col);
+}
+
+//Return the value of a cell
+int get_value(Game* game, int row, int col) {
+    return game->values[row * game->width + col];
+}
+
+//Fill the board with a random layout of the given shape. Interior cells
+//get a value from low to high and edge cells 0. About fill percent of the
+//interior cells start with a piece of either player, but at least one is
+//left vacant so the game is not over. Edge cells are always vacant and
+//either player may go first.
+void generate_board(Game* game, Shape* shape, uint64_t* state) {
+    int height = shape->height;
+    int width = shape->width;
+    size_board(game, height, width);
+    memset(game->xBits, 0, game->words * 5 * sizeof(uint64_t));
+    memset(game->rowEmpty, 0, (height + width) * sizeof(int));
+    memset(game->values, 0, game->cells);
+    game->xScore = 0;
+    game->oScore = 0;
+    game->emptyInterior = 0;
+    game->hash = 0;
+    game->layout = 0;
+    for(int i = 0; i < height; i++) {
+	for(int j = 0; j < width; j++) {
+	    if(is_corner(game, i, j)) {
+		continue;
+	    }
+	    int cell = i * width + j;
+	    game->values[cell] = get_bit(game->interior, cell) ? shape->low +
+		    next_random(state) % (shape->high - shape->low + 1) : 0;
+	    put_piece(game, cell, '.');
+	}
+    }
+    for(int cell = 0; shape->fill && cell < game->cells; cell++) {
+	if(get_bit(game->interior, cell) &&
+		next_random(state) % 100 < shape->fill) {
+	    put_piece(game, cell, (next_random(state) & 1) ? 'X' : 'O');
+	}
+    }
+    if(game->emptyInterior == 0) {
+	int cell;
+	do {
+	    cell = next_random(state) % game->cells;
+	} while(!get_bit(game->interior, cell));
+	put_piece(game, cell, '.');
+    }
+    game->p1 = (next_random(state) & 1) ? 'X' : 'O';
+}
+
+//Load one text row of a save file into the board. Corners must be blank,
+//every other cell a digit followed by '.', 'X' or 'O'. Return 0 if the
+//row is not valid.
+int load_row(Game* game, int row, char* line) {
+    if(strlen(line) < game->width * 2) {
+	return 0;
+    }
+    for(int j = 0; j < game->width; j++) {
+	char value = line[j * 2];
+	char piece = line[j * 2 + 1];
+	if(is_corner(game, row, j)) {
+	    if(value != ' ' || piece != ' ') {
+		return 0;
+	    }
+	    continue;
+	}
+	if(!isdigit(value) ||
+		!(piece == '.' || piece == 'X' || piece == 'O')) {
+	    return 0;
+	}
+	game->values[row * game->width + j] = value - '0';
+	put_piece(game, row * game->width + j, piece);
+    }
+    return 1;
+}
+
+//Write the two text characters of a cell (value then piece)
+void cell_text(Game* game, int row, int col, char* out) {
+    if(is_corner(game, row, col)) {
+	out[0] = ' ';
+	out[1] = ' ';
+	return;
+    }
+    out[0] = get_value(game, row, col) + '0';
+    out[1] = get_piece(game, row, col);
+}
+
+//Write the board as its save file rows into game->text, growing the
+//buffer only when the board has got bigger. Return the number of bytes.
+size_t render_board(Game* game) {
+    int rowBytes = game->width * 2 + 1;
+    size_t size = (size_t)game->height * rowBytes;
+    if(size > game->textSize) {
+	free(game->text);
+	free(game->shown);
+	game->text = malloc(size);
+	game->shown = NULL;
+	game->textSize = size;
+    }
+    for(int i = 0; i < game->height; i++) {
+	char* row = game->text + (size_t)i * rowBytes;
+	for(int j = 0; j < game->width; j++) {
+	    cell_text(game, i, j, row + j * 2);
+	}
+	row[rowBytes - 1] = '\n';
+    }
+    return size;
+}
+
+//Print the current board from the game struct with a single write. When
+//only changes are shown, rows that differ from the last board printed
+//are written as "row:text" after the first full board.
+void print_board(Game* game) {
+    if(game->display == QUIET) {
+	return;
+    }
+    size_t size = render_board(game);
+    if(game->display == FULL || game->shown == NULL) {
+	fwrite(game->text, 1, size, stdout);
+    } else {
+	int rowBytes = game->width * 2 + 1;
+	for(int i = 0; i < game->height; i++) {
+	    char* row = game->text + (size_t)i * rowBytes;
+	    if(memcmp(row, game->shown + (size_t)i * rowBytes, rowBytes)) {
+		printf("%d:", i);
+		fwrite(row, 1, rowBytes, stdout);
+	    }
+	}
+    }
+    if(game->display == CHANGES) {
+	if(game->shown == NULL) {
+	    game->shown = malloc(game->textSize);
+	}
+	memcpy(game->shown, game->text, size);
+    }
+}
+
+//Return the line at *text with its newline replaced by a NUL and move
+//*text to the start of the next line. Return NULL if there are no lines
+//left before end.
+char* next_line(char** text, char* end) {
+    char* line = *text;
+    if(line >= end) {
+	return NULL;
+    }
+    char* newline = memchr(line, '\n', end - line);
+    if(newline == NULL) {
+	*text = end; //the last line need not end in a newline
+    } else {
+	*newline = '\0';
+	*text = newline + 1;
+    }
+    return line;
+}
+
+//Read the board size and first player lines of a save file. The rows of
+//a board too big to hold, or to fit in the rest of the file at two bytes a
+//cell, are not read.
+Status read_header(Game* game, char** text, char* end) {
+    char* line = next_line(text, end);
+    if(!line ||
+	    sscanf(line, "%d %d", &(game->height), &(game->width)) != 2) {
+	return BADSAVE;
+    }
+    if((game->height < 3 || game->width < 3) ||
+	    game->height > INT32_MAX / game->width) {
+	return BADSAVE;
+    }
+    if(!(line = next_line(text, end))) {
+	return BADSAVE;
+    }
+    game->p1 = line[0];
+    if(!(game->p1 == 'X' || game->p1 == 'O')) { //check valid chars
+	return BADSAVE;
+    }
+    if((size_t)game->height * game->width * 2 > (size_t)(end - *text)) {
+	return BADSAVE;
+    }
+    return OK;
+}
+
+//Read the whole of a file into one buffer with a NUL after the contents.
+//Return NULL if the file can't be opened and set *size to 0 if it can't
+//be read.
+char* read_contents(char* fileName, size_t* size) {
+    struct stat info;
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0) {
+	return NULL;
+    }
+    *size = 0;
+    char* text = NULL;
+    if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode)) {
+	text = malloc(info.st_size + 1);
+	while(*size < info.st_size) {
+	    ssize_t got = read(fd, text + *size, info.st_size - *size);
+	    if(got <= 0) {
+		break;
+	    }
+	    *size += got;
+	}
+    } else {
+	text = malloc(1); //directories and the like have nothing to read
+    }
+    text[*size] = '\0';
+    close(fd);
+    return text;
+}
+
+//Read load file. Load files contents will be check for validity. If a
+//content are not valid the status is returned, else the game values will
+//be saved in the game struct and OK returned. The file is read in one go
+//and checked in a single pass over it, so rows may be any length. Binary
+//saves are told apart by their magic number.
+Status read_file(Game* game) {
+    size_t size;
+    char* contents = read_contents(game->file, &size);
+    if(contents == NULL) {
+	return BADFILE;
+    }
+    if(is_binary_save(contents, size)) {
+	Status status = load_binary(game, contents, size);
+	free(contents);
+	return status;
+    }
+    char* text = contents;
+    char* end = contents + size;
+    Status status = read_header(game, &text, end);
+    if(status == OK) {
+	create_board(game); //create and save game board
+	for(int i = 0; i < game->height && status == OK; i++) {
+	    char* line = next_line(&text, end);
+	    if(!line || !load_row(game, i, line)) {
+		status = BADSAVE;
+	    }
+	}
+    }
+    free(contents);
+    return status;
+}
+
+//Save the game in its current state to the named file. Names ending in
+//.bin are saved in the binary format. Return 0 if the file can't be
+//written.
+int write_save(Game* game, const char* name) {
+    if(is_binary_name(name)) {
+	return save_binary(game, name);
+    }
+    FILE* fileSave = fopen(name, "w");
+    if(fileSave == NULL) {
+	return 0;
+    }
+    fprintf(fileSave, "%d %d\n", game->height, game->width);
+    fprintf(fileSave, "%c\n", game->players[game->turn]);
+    size_t size = render_board(game);
+    int written = fwrite(game->text, 1, size, fileSave) == size;
+    return (fclose(fileSave) == 0) && written;
+}
+
+//Check if the interior of the board is full will return 1 if the board
+//is not full else 0
+int end_game(Game* game) {
+    return game->emptyInterior > 0;
+}
+
+//Check if the board is full on load. Return FULLBOARD if it is else OK.
+Status is_board_full(Game* game) {
+    if(end_game(game)) {
+	return OK;
+    }
+    return FULLBOARD;
+}
+
+//Check to see if a piece placed on the top row will cause a push down
+int can_push_down(Game* game, int col) {
+    return game->colEmpty[col] - get_bit(game->emptyBits, col) > 0;
+}
+
+//Check to see if a piece placed on the bottom row will cause a push up
+int can_push_up(Game* game, int col) {
+    int bottom = (game->height - 1) * game->width + col;
+    return game->colEmpty[col] - get_bit(game->emptyBits, bottom) > 0;
+}
+
+//Check to see if a piece placed in the left most column will cause a push
+//to the right
+int can_push_right(Game* game, int row) {
+    int left = row * game->width;
+    return game->rowEmpty[row] - get_bit(game->emptyBits, left) > 0;
+}
+
+//Check to see if a piece placed in the right most column will cause a push
+//to the left
+int can_push_left(Game* game, int row) {
+    int right = row * game->width + game->width - 1;
+    return game->rowEmpty[row] - get_bit(game->emptyBits, right) > 0;
+}
+
+//Check if a legal move has been made by the player
+int can_place(Game* game, int row, int col) {
+    int width = game->width;
+    int i = row * width + col;
+    //check if play out of array bounds
+    if(row > game->height - 1 || col > width - 1 || row < 0 || col < 0) {
+        return 0;
+    }
+    //check if push down legal
+    if(row == 0 && get_bit(game->emptyBits, i + width)) {
+        return 0;
+    }
+    //check if up legal
+    if(row == game->height - 1 && get_bit(game->emptyBits, i - width)) {
+        return 0;
+    }
+    //check if push right legal
+    if(col == 0 && get_bit(game->emptyBits, i + 1)) {
+        return 0;
+    }
+    //check if push left legal
+    if(col == width - 1 && get_bit(game->emptyBits, i - 1)) {
+        return 0;
+    }
+    //check if piece is placed on vacant spot. Corners are never vacant.
+    if(!get_bit(game->emptyBits, i)) {
+        return 0;
+    }
+    return 1;
+}
+
+//Check all direction to see if a legal push can be made
+int can_push(Game* game, int row, int col) {
+    if(row == 0) {
+	if(!(can_push_down(game, col))) { //legal push down
+	    return 0;
+        }
+    }
+    if(row == game->height - 1) {
+        if(!(can_push_up(game, col))) { //legal push up
+            return 0;
+        }
+    }
+    if(col == 0) {
+	if(!(can_push_right(game, row))) { //legal push right
+	    return 0;
+	}
+    }
+    if(col == game->width - 1) {
+	if(!(can_push_left(game, row))) { //legal push left
+	    return 0;
+	}
+    }
+    return 1;
+}
+
+//Check if move selected is legal. The legal moves are kept up to date as
+//cells fill and empty so this is a lookup.
+int legal_move(Game* game, int row, int col) {
+    if(row > game->height - 1 || col > game->width - 1 || row < 0 ||
+	    col < 0) {
+	return 0;
+    }
+    return get_bit(game->legalBits, row * game->width + col);
+}
+
+//Slide the pieces on a line of cells one step from the cell from towards
+//the cell to, overwriting whatever is in to, then put piece in from. A row
+//is contiguous in the planes so its pieces are shifted a word at a time,
+//with the moved pieces taken out of the scores and hash first and put back
+//after. Columns are strided so they are moved one cell at a time.
+void slide(Game* game, int from, int to, int step, char piece) {
+    if(step == 1 || step == -1) {
+	int low = (from < to) ? from : to;
+	int high = ((from < to) ? to : from) + 1;
+	set_vacant(game, to, 0); //to is about to get a piece
+	count_range(game, low, high, -1);
+	if(from < to) {
+	    shift_up(game->xBits, from, to);
+	    shift_up(game->oBits, from, to);
+	} else {
+	    shift_down(game->xBits, to, from);
+	    shift_down(game->oBits, to, from);
+	}
+	count_range(game, low, high, 1);
+    } else {
+	for(int i = to; i != from; i -= step) {
+	    put_piece(game, i, piece_at(game, i - step));
+	}
+    }
+    put_piece(game, from, piece);
+}
+
+//Work out the push of a legal play on the top row: down the selected
+//column as far as its first vacant cell
+Undo push_down(Game* game, int col) {
+    int top = col * game->height;
+    int i = first_bit(game->emptyCols, top + 1, top + game->height) - top;
+    return (Undo){game->width + col, i * game->width + col, game->width};
+}
+
+//Work out the push of a legal play on the bottom row: up the selected
+//column as far as its last vacant cell
+Undo push_up(Game* game, int col) {
+    int top = col * game->height;
+    int i = last_bit(game->emptyCols, top, top + game->height - 1) - top;
+    return (Undo){(game->height - 2) * game->width + col,
+	    i * game->width + col, -game->width};
+}
+
+//Work out the push of a legal play in the left most column: right along
+//the selected row as far as its first vacant cell
+Undo push_right(Game* game, int row) {
+    int left = row * game->width;
+    int i = first_bit(game->emptyBits, left + 1, left + game->width);
+    return (Undo){left + 1, i, 1};
+}
+
+//Work out the push of a legal play in the right most column: left along
+//the selected row as far as its last vacant cell
+Undo push_left(Game* game, int row) {
+    int left = row * game->width;
+    int i = last_bit(game->emptyBits, left, left + game->width - 1);
+    return (Undo){left + game->width - 2, i, -1};
+}
+
+//Work out what a legal move would change without making it: the cell the
+//new piece goes in, the vacant cell a push fills and the step between
+//them, which is 0 when a piece is placed in the interior with no push
+Undo plan_move(Game* game, int row, int col) {
+    if(row == 0) {
+	return push_down(game, col); //top row
+    } else if(row == game->height - 1) {
+	return push_up(game, col); //bottom row
+    } else if(col == 0) {
+	return push_right(game, row); //left col
+    } else if(col == game->width - 1) {
+	return push_left(game, row); //right col
+    }
+    return (Undo){row * game->width + col, row * game->width + col, 0};
+}
+
+//Make a legal move, pushing the pieces in its way if it was played on an
+//edge. Return what is needed to take the move back.
+Undo check_push(Game* game, int row, int col) {
+    Undo undo = plan_move(game, row, col);
+    if(undo.step == 0) {
+	put_piece(game, undo.from, game->players[game->turn]); //no push
+    } else {
+	slide(game, undo.from, undo.to, undo.step,
+		game->players[game->turn]);
+    }
+    return undo;
+}
+
+//Take back a move made by check_push. The pushed pieces slide back and
+//the cell the move filled is vacant again.
+void undo_push(Game* game, Undo undo) {
+    if(undo.step == 0) {
+	put_piece(game, undo.from, '.');
+	return;
+    }
+    slide(game, undo.to, undo.from, -undo.step, '.');
+}
+
+//Write the cell of every legal move into list in board order and return
+//how many there are
+int legal_moves(Game* game, int* list) {
+    int count = 0;
+    for(int w = 0; w < game->words; w++) {
+	uint64_t word = game->legalBits[w];
+	while(word) {
+	    list[count++] = w * 64 + __builtin_ctzll(word);
+	    word &= word - 1;
+	}
+    }
+    return count;
+}
+
+//Return the sum of the values of every cell holding the given piece
+int board_score(Game* game, char piece) {
+    return (piece == 'X') ? game->xScore : game->oScore;
+}
+
+//Return the first vacant interior cell scanning from the top left, or -1
+int first_empty(Game* game) {
+    for(int w = 0; w < game->words; w++) {
+	uint64_t word = game->emptyBits[w] & game->interior[w];
+	if(word) {
+	    return w * 64 + __builtin_ctzll(word);
+	}
+    }
+    return -1;
+}
+
+//Return the first vacant interior cell scanning from the bottom right,
+//or -1
+int last_empty(Game* game) {
+    for(int w = game->words - 1; w >= 0; w--) {
+	uint64_t word = game->emptyBits[w] & game->interior[w];
+	if(word) {
+	    return w * 64 + 63 - __builtin_clzll(word);
+	}
+    }
+    return -1;
+}
+
+//Return the move that places a piece in the given cell
+Move cell_move(Game* game, int cell) {
+    return (Move){cell / game->width, cell % game->width};
+}
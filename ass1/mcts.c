@@ -0,0 +1,259 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "push2310.h"
+
+#define EXPLORE 1.4
+
+//A node of the search tree: the position after playing move (a cell) from
+//the parent. The children of a node are kept together from index first,
+//which is 0 until the node is expanded. points counts 2 for each playout
+//won by the player who made the move and 1 for each draw.
+typedef struct Node {
+    int move;
+    int first;
+    int children;
+    int visits;
+    int points;
+} Node;
+
+//A playout thread. It plays on its own copy of the board, so the only
+//state it shares with the others is the tree. moves and path are sized
+//for the board so playouts never allocate.
+typedef struct Playout {
+    pthread_t thread;
+    struct Mcts* mcts;
+    Game* game;
+    int* moves;
+    int* path;
+    int size;
+    uint64_t random;
+} Playout;
+
+//State of the Monte Carlo tree search player (type 3). The tree is built
+//afresh for each move in a node array sized from the memory budget. All
+//threads share the tree: lock covers walking down and expanding it, and
+//results are added back with atomics once the lock has been let go.
+struct Mcts {
+    Settings settings;
+    Node* nodes;
+    int size;
+    int used;
+    pthread_mutex_t lock;
+    Game* root;
+    Playout* pool;
+    long started;
+    double deadline;
+};
+
+//Create a Monte Carlo player with the given limits. It runs
+//settings->playouts playouts for each move, or as many as it can in
+//settings->moveMillis when that is 0.
+Mcts* create_mcts(Settings* settings) {
+    Mcts* mcts = calloc(1, sizeof(Mcts));
+    mcts->settings = *settings;
+    mcts->size = ((uint64_t)settings->tableMegabytes << 20) / sizeof(Node);
+    mcts->nodes = malloc(sizeof(Node) * mcts->size);
+    pthread_mutex_init(&mcts->lock, NULL);
+    mcts->pool = calloc(settings->threads, sizeof(Playout));
+    for(int i = 0; i < settings->threads; i++) {
+	mcts->pool[i].mcts = mcts;
+	mcts->pool[i].game = calloc(1, sizeof(Game));
+	mcts->pool[i].random = i + 1;
+    }
+    return mcts;
+}
+
+//Free a Monte Carlo player
+void free_mcts(Mcts* mcts) {
+    for(int i = 0; i < mcts->settings.threads; i++) {
+	free(mcts->pool[i].game->xBits);
+	free(mcts->pool[i].game);
+	free(mcts->pool[i].moves);
+	free(mcts->pool[i].path);
+    }
+    pthread_mutex_destroy(&mcts->lock);
+    free(mcts->pool);
+    free(mcts->nodes);
+    free(mcts);
+}
+
+//Make sure a playout thread has room for a move in each cell of the board
+//and a path as long as the longest game
+void size_playout(Playout* playout, Game* game) {
+    if(playout->size >= game->cells) {
+	return;
+    }
+    free(playout->moves);
+    free(playout->path);
+    playout->moves = malloc(sizeof(int) * game->cells);
+    playout->path = malloc(sizeof(int) * (game->cells + 1));
+    playout->size = game->cells;
+}
+
+//Play the move in the given cell and pass the turn
+void play_cell(Game* game, int cell) {
+    check_push(game, cell / game->width, cell % game->width);
+    update_turn(game);
+}
+
+//Give the node's children to every legal move of the position. Return 0
+//if the tree is out of room or the game is over.
+int expand(Mcts* mcts, Node* node, Game* game, int* moves) {
+    if(!end_game(game)) {
+	return 0;
+    }
+    int count = legal_moves(game, moves);
+    if(mcts->used + count > mcts->size) {
+	return 0;
+    }
+    for(int i = 0; i < count; i++) {
+	Node* child = &mcts->nodes[mcts->used + i];
+	child->move = moves[i];
+	child->first = 0;
+	child->children = 0;
+	child->visits = 0;
+	child->points = 0;
+    }
+    node->first = mcts->used;
+    node->children = count;
+    mcts->used += count;
+    return 1;
+}
+
+//Return the child to follow from an expanded node, by the UCT rule.
+//Children that have not been visited are tried first.
+int select_child(Mcts* mcts, Node* node) {
+    double logVisits = log(node->visits + 1);
+    double bestValue = -1;
+    int best = node->first;
+    for(int i = node->first; i < node->first + node->children; i++) {
+	Node* child = &mcts->nodes[i];
+	if(child->visits == 0) {
+	    return i;
+	}
+	int points = __atomic_load_n(&child->points, __ATOMIC_RELAXED);
+	double value = points / (2.0 * child->visits) +
+		EXPLORE * sqrt(logVisits / child->visits);
+	if(value > bestValue) {
+	    bestValue = value;
+	    best = i;
+	}
+    }
+    return best;
+}
+
+//Walk down the tree from the root playing each move on the thread's
+//board, expand the leaf reached and step into one of its children. Each
+//node on the way is counted as visited straight away so other threads
+//spread out over the tree rather than all following the same path.
+//Return the length of the path.
+int descend(Playout* playout) {
+    Mcts* mcts = playout->mcts;
+    Game* game = playout->game;
+    int length = 0;
+    int index = 0;
+    pthread_mutex_lock(&mcts->lock);
+    mcts->nodes[0].visits++;
+    playout->path[length++] = 0;
+    while(mcts->nodes[index].children) {
+	index = select_child(mcts, &mcts->nodes[index]);
+	mcts->nodes[index].visits++;
+	playout->path[length++] = index;
+	play_cell(game, mcts->nodes[index].move);
+    }
+    if(expand(mcts, &mcts->nodes[index], game, playout->moves)) {
+	index = select_child(mcts, &mcts->nodes[index]);
+	mcts->nodes[index].visits++;
+	playout->path[length++] = index;
+	play_cell(game, mcts->nodes[index].move);
+    }
+    pthread_mutex_unlock(&mcts->lock);
+    return length;
+}
+
+//Play random legal moves until the game is over
+void random_playout(Playout* playout) {
+    Game* game = playout->game;
+    while(end_game(game)) {
+	int count = legal_moves(game, playout->moves);
+	play_cell(game, playout->moves[next_random(&playout->random) % count]);
+    }
+}
+
+//Add the result of a finished playout to every node on its path. The
+//player who made the move into a node is the one to play at its parent.
+void add_playout(Playout* playout, int length) {
+    Mcts* mcts = playout->mcts;
+    Game* game = playout->game;
+    int margin = board_score(game, 'O') - board_score(game, 'X');
+    int oPoints = (margin > 0) ? 2 : (margin == 0) ? 1 : 0;
+    char mover = mcts->root->players[mcts->root->turn];
+    for(int i = 1; i < length; i++) {
+	int points = (mover == 'O') ? oPoints : 2 - oPoints;
+	__atomic_add_fetch(&mcts->nodes[playout->path[i]].points, points,
+		__ATOMIC_RELAXED);
+	mover = (mover == 'O') ? 'X' : 'O';
+    }
+}
+
+//Return 1 while the player still has playouts to run for this move
+int more_playouts(Mcts* mcts) {
+    if(mcts->settings.playouts) {
+	return __atomic_fetch_add(&mcts->started, 1, __ATOMIC_RELAXED) <
+		mcts->settings.playouts;
+    }
+    return now() < mcts->deadline;
+}
+
+//Thread start routine. Run playouts from the root position until the
+//player's budget for the move is used up.
+void* run_playouts(void* arg) {
+    Playout* playout = arg;
+    Mcts* mcts = playout->mcts;
+    while(more_playouts(mcts)) {
+	copy_board(playout->game, mcts->root);
+	int length = descend(playout);
+	random_playout(playout);
+	add_playout(playout, length);
+    }
+    return NULL;
+}
+
+//Type 3 automated player. Grow a search tree from the current position
+//with random playouts spread over the player's threads, then play the
+//move that was tried the most.
+Move mcts_move(Game* game) {
+    Mcts* mcts = game->mcts;
+    int threads = mcts->settings.threads;
+    Node* root = &mcts->nodes[0];
+    memset(root, 0, sizeof(Node));
+    mcts->used = 1;
+    mcts->root = game;
+    mcts->started = 0;
+    mcts->deadline = now() + mcts->settings.moveMillis / 1000.0;
+    for(int i = 0; i < threads; i++) {
+	size_playout(&mcts->pool[i], game);
+    }
+    for(int i = 1; i < threads; i++) {
+	pthread_create(&mcts->pool[i].thread, NULL, run_playouts,
+		&mcts->pool[i]);
+    }
+    run_playouts(&mcts->pool[0]);
+    for(int i = 1; i < threads; i++) {
+	pthread_join(mcts->pool[i].thread, NULL);
+    }
+    if(root->children == 0) { //not even the root could be expanded
+	legal_moves(game, mcts->pool[0].moves);
+	return cell_move(game, mcts->pool[0].moves[0]);
+    }
+    int best = root->first;
+    for(int i = root->first; i < root->first + root->children; i++) {
+	if(mcts->nodes[i].visits > mcts->nodes[best].visits) {
+	    best = i;
+	}
+    }
+    return cell_move(game, mcts->nodes[best].move);
+}
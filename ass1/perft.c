@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "push2310.h"
+
+//A perft run split at the root. Threads take root moves in turn from next
+//and add the count under each to nodes.
+typedef struct Perft {
+    Game* root;
+    int depth;
+    int* rootMoves;
+    int rootCount;
+    int next;
+    long nodes;
+} Perft;
+
+//A thread of a perft run with its own copy of the board and a move list
+//for each ply
+typedef struct Counter {
+    pthread_t thread;
+    Perft* run;
+    Game* game;
+    int** lists;
+} Counter;
+
+//Count the move sequences of the given length from the position. A game
+//that ends early counts as one sequence. Each move is made with
+//check_push and taken back with undo_push. lists holds a move list for
+//each ply still to go.
+long perft(Game* game, int depth, int** lists) {
+    if(depth == 0 || !end_game(game)) {
+	return 1;
+    }
+    int* list = lists[depth - 1];
+    int count = legal_moves(game, list);
+    if(depth == 1) {
+	return count;
+    }
+    long nodes = 0;
+    for(int i = 0; i < count; i++) {
+	Undo undo = check_push(game, list[i] / game->width,
+		list[i] % game->width);
+	update_turn(game);
+	nodes += perft(game, depth - 1, lists);
+	update_turn(game);
+	undo_push(game, undo);
+    }
+    return nodes;
+}
+
+//Thread start routine. Count the sequences under root moves taken in turn
+//until there are none left.
+void* count_root(void* arg) {
+    Counter* counter = arg;
+    Perft* run = counter->run;
+    Game* game = counter->game;
+    int i;
+    copy_board(game, run->root);
+    while((i = __atomic_fetch_add(&run->next, 1, __ATOMIC_RELAXED)) <
+	    run->rootCount) {
+	int cell = run->rootMoves[i];
+	Undo undo = check_push(game, cell / game->width, cell % game->width);
+	update_turn(game);
+	long nodes = perft(game, run->depth - 1, counter->lists);
+	update_turn(game);
+	undo_push(game, undo);
+	__atomic_add_fetch(&run->nodes, nodes, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+//Count the move sequences of the given length from the game's position,
+//split at the root across the given number of threads
+long parallel_perft(Game* game, int depth, int threads) {
+    if(depth < 2 || !end_game(game)) {
+	int* list = malloc(sizeof(int) * game->cells);
+	long nodes = (depth && end_game(game)) ? legal_moves(game, list) : 1;
+	free(list);
+	return nodes;
+    }
+    Perft run = {game, depth, malloc(sizeof(int) * game->cells), 0, 0, 0};
+    run.rootCount = legal_moves(game, run.rootMoves);
+    Counter* pool = calloc(threads, sizeof(Counter));
+    for(int i = 0; i < threads; i++) {
+	pool[i].run = &run;
+	pool[i].game = calloc(1, sizeof(Game));
+	pool[i].lists = malloc(sizeof(int*) * depth);
+	for(int j = 0; j < depth; j++) {
+	    pool[i].lists[j] = malloc(sizeof(int) * game->cells);
+	}
+	pthread_create(&pool[i].thread, NULL, count_root, &pool[i]);
+    }
+    for(int i = 0; i < threads; i++) {
+	pthread_join(pool[i].thread, NULL);
+	for(int j = 0; j < depth; j++) {
+	    free(pool[i].lists[j]);
+	}
+	free(pool[i].lists);
+	free(pool[i].game->xBits);
+	free(pool[i].game);
+    }
+    free(pool);
+    free(run.rootMoves);
+    return run.nodes;
+}
+
+//Run perft on one board to the given depth and print the count and rate.
+//Return 0 if expected is not -1 and the count is not what was expected.
+int perft_board(char* fileName, int depth, long expected, int threads) {
+    Game* game = calloc(1, sizeof(Game));
+    game->file = fileName;
+    Status status = read_file(game);
+    if(status == OK) {
+	status = is_board_full(game);
+    }
+    if(status != OK) {
+	exit_status(status);
+    }
+    init_turn(game);
+    double start = now();
+    long nodes = parallel_perft(game, depth, threads);
+    double seconds = now() - start;
+    printf("%s depth %d: %ld nodes, %.3fs, %.0f nodes/s", fileName, depth,
+	    nodes, seconds, seconds > 0 ? nodes / seconds : 0.0);
+    if(expected >= 0 && nodes != expected) {
+	printf(" (expected %ld)\n", expected);
+    } else {
+	printf(expected >= 0 ? " ok\n" : "\n");
+    }
+    free(game->xBits);
+    free(game);
+    return expected < 0 || nodes == expected;
+}
+
+//Run perft on every board in a list file and check the counts.
+//  push2310 -P [-t threads] listfile
+//Each line of the list is a board file, a depth and optionally the
+//expected count. Board files are relative to the list's directory. A list
+//with no boards in it checks nothing, so it is a usage error. The thread
+//count defaults to the number of online processors.
+int run_perft(int argc, char** argv) {
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    char* list = argv[2];
+    if(argc == 5 && !strcmp(argv[2], "-t")) {
+	char* err;
+	threads = strtol(argv[3], &err, 10);
+	if(argv[3][0] == '\0' || *err != '\0' || threads < 1) {
+	    exit_status(PERFTARGS);
+	}
+	list = argv[4];
+    } else if(argc != 3) {
+	exit_status(PERFTARGS);
+    }
+    if(threads < 1) {
+	threads = 1;
+    }
+    size_t size;
+    char* contents = read_contents(list, &size);
+    if(contents == NULL) {
+	exit_status(BADFILE);
+    }
+    char* slash = strrchr(list, '/');
+    int dirLength = slash ? slash - list + 1 : 0;
+    char* text = contents;
+    char* line;
+    int passed = 1;
+    int boards = 0;
+    while((line = next_line(&text, contents + size))) {
+	int depth;
+	long expected = -1;
+	if(line[0] == '\0' || line[0] == '#') {
+	    continue;
+	}
+	char* board = malloc(strlen(line) + dirLength + 1);
+	memcpy(board, list, dirLength);
+	if(sscanf(line, "%s %d %ld", board + dirLength, &depth,
+		&expected) < 2 || depth < 0) {
+	    exit_status(PERFTARGS);
+	}
+	passed &= perft_board(board, depth, expected, threads);
+	boards++;
+	free(board);
+    }
+    free(contents);
+    if(boards == 0) {
+	exit_status(PERFTARGS);
+    }
+    if(!passed) {
+	exit_status(BADPERFT);
+    }
+    return OK;
+}
@@ -4,412 +4,159 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include <string.h>
+#include "push2310.h"
 
-typedef enum {
-    OK = 0,
-    INCORRECTARGS = 1,
-    BADPLAYER = 2,
-    BADFILE = 3,
-    BADSAVE = 4,
-    ENDOFFILE = 5,
-    FULLBOARD = 6
-} Status;
-
-typedef struct Game {
-    int height;
-    int width;
-    int turn;
-    char p1;
-    char p2;
-    char players[2];
-    char pType[2];
-    char* file;
-    char** board;
-} Game;
-
-//Exit the game and show the error message of the exit
-Status exit_status(Status s) {
+//Return the error message shown for a status
+const char* status_message(Status s) {
     const char* messages[] = {"",
 	    "Usage: push2310 typeO typeX fname\n",
 	    "Invalid player type\n",
 	    "No file to load from\n",
 	    "Invalid file contents\n",
 	    "End of file\n",
-	    "Full board in load\n"};
-    fputs(messages[s], stderr);
-    exit(s);
-}
-
-//Create the game board from values in read files. Save board to struct.
-void create_board(Game* game) {
-    game->board = malloc(sizeof(char*) * game->height);
-    for(int i = 0; i < game->height; i++) {
-	game->board[i] = malloc(sizeof(char*) * (game->width * 2));
-    }
-}
-
-//Print the current board from the game struct
-void print_board(Game* game) {
-    for(int i = 0; i < game->height; i++) {
-	for(int j = 0; j < game->width * 2; j++) {
-	    printf("%c", game->board[i][j]);
-	}
-	printf("\n");
-    }
-}
-
-//Read load file. Load files contents will be check for validity. If a 
-//content are not valid game will exit with status else, the game values will
-//be saved in the game struct
-void read_file(Game* game) {
-    char text[256];
-    char lines[1024];
-    FILE* fileRead = fopen(game->file, "r");
-    if(fileRead == NULL) {
-	exit_status(BADFILE);
-    }
-    fgets(text, 256, fileRead);
-    sscanf(text, "%d %d\n", &(game->height), &(game->width));
-    if((game->height < 3 || game->width < 3)) {
-	exit_status(4);
-    }
-    fgets(text, 256, fileRead);
-    sscanf(text, "%c\n", &(game->p1));
-    if(!(game->p1 == 'X' || game->p1 == 'O')) { //check valid chars
-	exit_status(4);
-    }
-    create_board(game); //create and save game board
-    for(int i = 0; i < game->height; i++) {
-	if(fgets(lines, 1024, fileRead) != NULL) {
-	    for(int j = 0; j < game->width * 2; j++) { 
-		game->board[i][j] = lines[j];
-	    }
-	}
-    }
-    fclose(fileRead);
-}
-
-//Save the game in its current state with given file name
-void save_game(Game* game, char* fileName) {
-    char name[strlen(fileName) - 1]; 
-    for(int i = 0; i < strlen(fileName) - 1; i++) {
-	name[i] = fileName[i];
-    }
-    name[strcspn(name, "\n")] = 0; //remove '\n' from array
-    FILE* fileSave = fopen(name, "w");
-    if(fileSave != NULL) {
-	fprintf(fileSave, "%d %d\n", game->height, game->width);
-	fprintf(fileSave, "%c\n", game->players[game->turn]);
-	for(int i = 0; i < game->height; i++) {
-	    for(int j = 0; j < game->width * 2; j++) {
-		fprintf(fileSave, "%c", game->board[i][j]);
-	    }
-	    fprintf(fileSave, "\n");
-	}
-    }
-    fclose(fileSave);
-}
-
-//Check if the board is full on load. If the board is full on load 
-//game will exit with status.
-void is_board_full(Game* game) {
-    for(int i = 1; i < game->height - 1; i++) {
-	for(int j = 3; j < (game->width * 2) - 2; j++) {
-	    if(game->board[i][j] == '.') { 
-		return;
-	    }
-	}
-    }
-    exit_status(FULLBOARD);
-}
-		
-//Check to see if a piece placed on the top row will cause a push down
-int can_push_down(Game* game, int row, int col) {
-    for(int i = 0; i < game->height - 1; i++) {
-    	if(game->board[row + 1 + i][col] == '.') {
-            return 1;
-        }
-    }
-    return 0;
-} 
-
-//Check to see if a piece placed on the bottom row will cause a push up
-int can_push_up(Game* game, int row, int col) {
-    for(int i = 0; i < game->height - 1; i++) {
-    	if(game->board[row - 1 - i][col] == '.') {
-            return 1;                                                 
-    	}
-    }
-    return 0;
+	    "Full board in load\n",
+	    "Usage: push2310 -b typeO typeX games [-t threads] [-l millis] "
+	    "[-m megabytes] [-p playouts] [-D depth] [-j threads] "
+	    "[-B tablebase] [-x records] "
+	    "(fname... | dir | -r seed height width)\n",
+	    "Invalid move log\n",
+	    "Usage: push2310 -R fname logfile\n",
+	    "Usage: push2310 -P [-t threads] listfile\n",
+	    "Perft counts do not match\n",
+	    "Usage: push2310 -T outfile [-m megabytes] [-D depth] "
+	    "[-j threads] fname...\n",
+	    "Invalid tablebase\n",
+	    "Usage: push2310 -S socket [-l millis] [-m megabytes] "
+	    "[-p playouts] [-D depth] [-j threads] [-B tablebase]\n",
+	    "Can't listen on socket\n",
+	    "Can't write records\n",
+	    "Usage: push2310 -Z seed games height width [-v low high] "
+	    "[-f fill] [-u]\n",
+	    "Invariant failed\n"};
+    return messages[s];
 }
 
-//Check to see if a piece placed in the left most column will cause a push 
-//to the right
-int can_push_right(Game* game, int row, int col) {
-    for(int i = 0; i < game->width * 2 - 1; i++) {
-	if(game->board[row][col + 2 + i] == '.') {
-	    return 1;
-	}
-    }
-    return 0;
-}
-
-//Check to see if a piece placed in the right most column will cause a push
-//to the left
-int can_push_left(Game* game, int row, int col) {
-    for(int i = 0; i < game->width * 2 - 1; i++) {
-	if(game->board[row][col - 2 - i] == '.') {
-	    return 1;
-	}
-    }
-    return 0;
-}
-
-//Check if a legal move has been made by the player
-int can_place(Game* game, int row, int col) {
-    //check if play out of array bounds
-    if(row > game->height - 1 || col > game->width * 2 - 1 ||
-	    row < 0 || col < 0) {
-        return 0;
-    }
-    //check if push down legal
-    if(row == 0 && game->board[row + 1][col] == '.') {
-        return 0;
-    }
-    //check if up legal
-    if(row == game->height - 1 && game->board[row - 1][col] == '.') { 
-        return 0;
-    }
-    //check if push right legal
-    if(col == 1 && game->board[row][col + 2] == '.') {
-        return 0;
-    }
-    //check if push left legal
-    if(col == game->width * 2 - 1 && game->board[row][col - 2] == '.') {
-        return 0;
-    }
-    if(col == 1 && game->board[row][col + 2] == '.') {
-    	return 0;
-    }
-    //check oif piece is not being placed in board corners
-    if(game->board[row][col] == ' ') {
-        return 0;
-    }
-    //check if piece jis placed on vacant spot
-    if(game->board[row][col] != '.') {
-        return 0;
-    }
-    return 1;
-}
-
-//Check all direction to see if a legal push can be made
-int can_push(Game* game, int row, int col) {
-    if(row == 0) {    
-	if(!(can_push_down(game, row, col))) { //legal push down
-	    return 0;
-        }
-    }
-    if(row == game->height - 1) {
-        if(!(can_push_up(game, row, col))) { //legal push up
-            return 0;
-        }
-    }
-    if(col == 1) {
-	if(!(can_push_right(game, row, col))) { //legal push right
-	    return 0;
-	}
-    }
-    if(col == game->width * 2 - 1) {
-	if(!(can_push_left(game, row, col))) { //legal push left
-	    return 0;
-	}
-    }
-    return 1;
-}
-
-//Check if move selected is legal
-int legal_move(Game* game, int row, int col) {
-    if(!(can_place(game, row, col))) {
-	return 0;
-    }
-    if(!(can_push(game, row, col))) {
-	return 0;
-    }
-    return 1;
-}
-
-//If a legal play was made on the top row push down all applicable 
-//pieces in the selected column
-void push_down(Game* game, int row, int col) {
-    int i = 0;
-    while(game->board[row + i + 1][col] != '.') {
-	i++; //increments based on how many consecutive player chars
-    }
-    for(int j = i; j > 0; j--) { //push pieces 
-	game->board[row + j + 1][col] = game->board[row + j][col];
-    }
-    game->board[row + 1][col] = game->players[game->turn];
-}
-
-//If a legal play was made on the bottom row push down all applicable  
-//pieces in the selected column
-void push_up(Game* game, int row, int col) {
-    int i = 0;
-    while(game->board[row - i - 1][col] != '.') {
-	i++;
-    }
-    for(int j = i; j > 0; j--) {
-	game->board[row - j - 1][col] = game->board[row - j][col];
-    }
-    game->board[row - 1][col] = game->players[game->turn];
-}
-
-//If a legal play was made in the left most column push to the right all
-//applicable  pieces in the select row
-void push_right(Game* game, int row, int col) {
-    int i = 0;
-    while(game->board[row][2 * i + 3] != '.') {
-	i++;
-    }
-    for(int j = i; j > 0; j--) {
-	game->board[row][2 * j + 3] = game->board[row][j * 2 + 1];
-    }
-    game->board[row][3] = game->players[game->turn];
+//Exit the game and show the error message of the exit
+Status exit_status(Status s) {
+    fputs(status_message(s), stderr);
+    exit(s);
 }
 
-//If a legal play was made in the right most column push to the left all
-//applicable pieces in the selected row
-void push_left(Game* game, int row, int col) {
-    int i = 0;
-    while(game->board[row][col * 2 - 1 - (2 * i)] != '.') {
-	i++; 
-    }
-    for(int j = i; j > 0; j--) {
-	game->board[row][col * 2 - 1 - (2 * j)] = 
-		game->board[row][col * 2 + 1 - (2 * j)];
-    }
-    game->board[row][col * 2 - 1] = game->players[game->turn];
-}
 
-//If a legal move was made that could cause a push check to see if a push
-//could be made if not player the piece normally
-void check_push(Game* game, int row, int col) {
-    if(row == 0) {
-	push_down(game, row, col * 2 + 1); //top row
-    } else if(row == game->height - 1) {
-	push_up(game, row, col * 2 + 1); //bottom row
-    } else if(col == 0) {
-	push_right(game, row, col); //left col
-    } else if(col == game->width - 1) {
-	push_left(game, row, col); //right col
-    } else { //no push found player move
-	game->board[row][col * 2 + 1] = game->players[game->turn];
-    }
-}
-
-//If player is human, wait for player input and check if a legal move was 
+//What a line of human input asks for
+typedef enum {
+    NOTHING = 0,
+    PLACE = 1,
+    SAVE = 2,
+    BADNAME = 3
+} Input;
+
+//Read a whole number of at most 9 digits and move the text past it.
+//Return -1 if the text does not start with one.
+int read_number(char** text) {
+    int value = 0;
+    int digits = 0;
+    for(; **text >= '0' && **text <= '9'; (*text)++) {
+	if(++digits > 9) {
+	    return -1;
+	}
+	value = value * 10 + (**text - '0');
+    }
+    return digits ? value : -1;
+}
+
+//Work out what a line of human input asks for in a single pass over it,
+//without copying it. "R C" places a piece and "sFILE" saves the game to
+//FILE, which is ended in place. A first word holding a '/' is a bad save
+//name. Anything else asks for nothing.
+Input parse_input(char* line, Move* move, char** name) {
+    char* text = line;
+    while(*text == ' ') {
+	text++;
+    }
+    char* word = text;
+    char* wordEnd = text + strcspn(text, " ");
+    if(memchr(word, '/', wordEnd - word)) {
+	return BADNAME;
+    }
+    if(word[0] == 's' && word[1] != '\n' && word[1] != '\0' &&
+	    word[1] != ' ') {
+	*name = word + 1;
+	(*name)[strcspn(*name, " \n")] = '\0';
+	return SAVE;
+    }
+    move->row = read_number(&text);
+    if(move->row < 0 || *text != ' ') {
+	return NOTHING;
+    }
+    while(*text == ' ') {
+	text++;
+    }
+    move->col = read_number(&text);
+    if(move->col < 0 || !(*text == '\0' || (text[0] == '\n' &&
+	    text[1] == '\0'))) {
+	return NOTHING;
+    }
+    return PLACE;
+}
+
+//If player is human, wait for player input and check if a legal move was
 //selected. If a move made was illigal or a game was saved, repromt the player
-//to make a move.
-void human_move(Game* game) {
-    char move[64];
-    char temp[64];
-    char* err1, *err2, *input1, *input2;
-    int legal = 0;
-    int row, col;
-    while(legal == 0) {
-	int invalid = 0;
+//to make a move. Return the legal move the player chose.
+Move human_move(Game* game) {
+    char line[64];
+    Move move;
+    char* name;
+    while(1) {
         printf("%c:(R C)> ", game->players[game->turn]);
-	if(!(fgets(move, 64, stdin))) {
+	if(!(fgets(line, sizeof(line), stdin))) {
 	    exit_status(ENDOFFILE);
 	}
-	memcpy(temp, move, 64);
-	input1 = strtok(temp, " "); //get the first player input
-	for(int i = 0; i < strlen(input1); i++) {
-	    if(input1[i] == '/') { //check for / in save file name
-		invalid = 1;
-	    }
-	}
-	if(invalid == 1) {
+	Input input = parse_input(line, &move, &name);
+	if(input == BADNAME) {
 	    fprintf(stderr, "Save failed\n");
-	    continue;
-	}
-	if(input1[0] == 's' && input1[1] != '\n') { //save must be 1 string
-	    char* fileName = input1 + 1;
-	    save_game(game, fileName);
-	    continue;
-	}
-	if(input1 == NULL) { //player entered nothing (just '\n')
-	    continue;
-	}
-	input2 = strtok(NULL, "\n");
-	if(input2 == NULL) {
-	    continue;
-	}
-	row = strtoul(input1, &err1, 10);
-	col = strtoul(input2, &err2, 10);
-	if(*err1 != '\0' || *err2 != '\0') {
-	    continue;
-	}
-	if((!legal_move(game, row, col * 2 + 1))) {
-	    continue;
+	} else if(input == SAVE) {
+	    write_save(game, name);
+	} else if(input == PLACE && legal_move(game, move.row, move.col)) {
+	    return move;
 	}
-	legal = 1;
     }
-    check_push(game, row, col); //check if player will cause push
 }
 
 //If automated player type 0 char is O, scan the board from the top left to
 //find a vacant spot to play piece
-void type0_omove(Game* game) {
-    for(int i = 1; i < game->height - 1; i++) {
-	for(int j = 3; j < game->width * 2 - 1; j += 2) {
-	    if(game->board[i][j] == '.') {
-		game->board[i][j] = 'O';
-		printf("Player O placed at %d %d\n", i, j / 2);
-		return;
-	    }
-	}
-    }
+Move type0_omove(Game* game) {
+    return cell_move(game, first_empty(game));
 }
 
-//If automated player type 0 char is X, scan the board from the bottom right 
+//If automated player type 0 char is X, scan the board from the bottom right
 //to find a vacant spot to play piece
-void type0_xmove(Game* game) {
-    for(int i = game->height - 2; i > 0; i--) {
-	for(int j = game->width * 2 - 3; j > 1; j -= 2) {
-	    if(game->board[i][j] == '.') {
-		game->board[i][j] = 'X';
-		printf("Player X placed at %d %d\n", i, j / 2);
-		return;
-	    }
-	}
-    }
+Move type0_xmove(Game* game) {
+    return cell_move(game, last_empty(game));
 }
 
 //If automated player is type 0, check which player char they are and make
 //a move accordingly
-void type0_move(Game* game) {
+Move type0_move(Game* game) {
     if(game->players[game->turn] == 'O') {
-	type0_omove(game);
-    }
-    if(game->players[game->turn] == 'X') {
-	type0_xmove(game);
+	return type0_omove(game);
     }
+    return type0_xmove(game);
 }
 
-//Check if the type 1 automated player move will lower the opposing players 
+//Check if the type 1 automated player move will lower the opposing players
 //score if pushing down
 int lower_down(Game* game, int col) {
     int newScore = 0;
     int currentScore = 0;
     char p2 = game->players[(game->turn + 1) % 2];
     for(int i = 1; i < game->height; i++) {
-	if(game->board[i][col] == '.') {
+	if(get_piece(game, i, col) == '.') {
 	    break;
 	}
-	if(game->board[i][col] == p2 && ((i + 1) < game->height)) {
-	    currentScore = currentScore + game->board[i][col - 1];
-	    newScore = newScore + game->board[i + 1][col - 1];
+	if(get_piece(game, i, col) == p2 && ((i + 1) < game->height)) {
+	    currentScore = currentScore + get_value(game, i, col);
+	    newScore = newScore + get_value(game, i + 1, col);
 	}
     }
     if(newScore < currentScore) {
@@ -425,13 +172,13 @@ int lower_left(Game* game, int row) {
     int newScore = 0;
     int currentScore = 0;
     char p2 = game->players[(game->turn + 1) % 2];
-    for(int i = game->width * 2 - 3; i > 1; i -= 2) {
-	if(game->board[row][i] == '.') {
-	    break;      
+    for(int i = game->width - 2; i > 0; i--) {
+	if(get_piece(game, row, i) == '.') {
+	    break;
 	}
-	if(game->board[row][i] == p2 && ((i - 3) >= 0)) {
-	    currentScore = currentScore + game->board[row][i - 1];
-	    newScore = newScore + game->board[row][i - 3];
+	if(get_piece(game, row, i) == p2) {
+	    currentScore = currentScore + get_value(game, row, i);
+	    newScore = newScore + get_value(game, row, i - 1);
 	}
     }
     if(newScore < currentScore) {
@@ -448,12 +195,12 @@ int lower_up(Game* game, int col) {
     int currentScore = 0;
     char p2 = game->players[(game->turn + 1) % 2];
     for(int i = game->height - 2; i > 0; i--) {
-	if(game->board[i][col] == '.') {
+	if(get_piece(game, i, col) == '.') {
 	    break;
 	}
-	if(game->board[i][col] == p2) {
-	    currentScore = currentScore + game->board[i][col - 1];
-	    newScore = newScore + game->board[i - 1][col - 1];
+	if(get_piece(game, i, col) == p2) {
+	    currentScore = currentScore + get_value(game, i, col);
+	    newScore = newScore + get_value(game, i - 1, col);
 	}
     }
     if(newScore < currentScore) {
@@ -469,13 +216,13 @@ int lower_right(Game* game, int row) {
     int newScore = 0;
     int currentScore = 0;
     char p2 = game->players[(game->turn + 1) % 2];
-    for(int i = 3; i < game->width * 2; i += 2) {
-	if(game->board[row][i] == '.') {
+    for(int i = 1; i < game->width; i++) {
+	if(get_piece(game, row, i) == '.') {
 	    break;
 	}
-	if(game->board[row][i] == p2) {
-	    currentScore = currentScore + game->board[row][i - 1];
-	    newScore = newScore + game->board[row][i + 1];
+	if(get_piece(game, row, i) == p2) {
+	    currentScore = currentScore + get_value(game, row, i);
+	    newScore = newScore + get_value(game, row, i + 1);
 	}
     }
     if(newScore < currentScore) {
@@ -487,105 +234,58 @@ int lower_right(Game* game, int row) {
 
 //If a move cannot be found that will cause a push resulting in the opposing
 //players score being reduced. Make a move in the highest value cell
-void type1_first_move(Game* game) {
-    int row, col;
-    int highNumber = 0;
-    for(int i = 1; i < game->height - 1; i++) {                       
-	for(int j = 3; j < game->width * 2 - 1; j += 2) {
-	    if(game->board[i][j - 1] > highNumber && 
-		    game->board[i][j] == '.') { //compare cell to current high
-		row = i;
-		col = j;
-		highNumber = game->board[i][j - 1];
-	    }
-	}
-    }
-    printf("Player %c placed at %d %d\n", game->players[game->turn], 
-	    row, col / 2);
-    game->board[row][col] = game->players[game->turn];
+Move type1_first_move(Game* game) {
+    return cell_move(game, best_empty(game));
 }
 
 //If automated play is type 1, scan the board to check for the most 
 //appropriate move based off the required movement pattern of the player
-void type1_move(Game* game) {
-    char** board = game->board; //temp struct variables to reduce clutter
-    int height = game->height; 
-    int width = game->width * 2;
-    for(int i = 3; i < width - 2; i += 2) { //check top row
-	if(board[1][i] != '.' && board[height - 1][i] == '.' && 
-		board[0][i] == '.') { 
+Move type1_move(Game* game) {
+    int height = game->height; //temp struct variables to reduce clutter
+    int width = game->width;
+    for(int i = 1; i < width - 1; i++) { //check top row
+	if(get_piece(game, 1, i) != '.' && 
+		get_piece(game, height - 1, i) == '.' && 
+		get_piece(game, 0, i) == '.') { 
 	    if(lower_down(game, i)) { //check if a piece can be pushed
-		check_push(game, 0, i / 2);
-		printf("Player %c placed at 0 %d\n", 
-			game->players[game->turn], i / 2);
-		return;
+		return (Move){0, i};
 	    }
 	}
     }
     for(int i = 1; i < height - 1; i++) { //right column
-	if(board[i][width - 3] != '.' && board[i][1] == '.' && 
-		board[i][width - 1] == '.') {
-	    if(lower_left(game, i) && board[i][1] == '.') {
-		check_push(game, i, game->width - 1);
-		printf("Player %c placed at %d %d\n", 
-			game->players[game->turn], i, width / 2 - 1);
-		return;
+	if(get_piece(game, i, width - 2) != '.' && 
+		get_piece(game, i, 0) == '.' && 
+		get_piece(game, i, width - 1) == '.') {
+	    if(lower_left(game, i)) {
+		return (Move){i, width - 1};
 	    }
 	}
     }
-    for(int i = width - 3; i > 0; i -= 2) { //check bottom row
-	if(board[height - 2][i] != '.' && board[0][i] == '.' && 
-		board[height - 1][i] == '.') {
+    for(int i = width - 2; i > 0; i--) { //check bottom row
+	if(get_piece(game, height - 2, i) != '.' && 
+		get_piece(game, 0, i) == '.' && 
+		get_piece(game, height - 1, i) == '.') {
 	    if(lower_up(game, i)) {
-		check_push(game, height - 1, i / 2);
-		printf("Player %c placed at %d %d\n",
-			game->players[game->turn], height - 1, i / 2);
-		return;
+		return (Move){height - 1, i};
 	    }
 	}
     }
     for(int i = height - 2; i > 0; i--) { //check left column
-	if(board[i][3] != '.' && board[i][width - 1] == '.' && 
-		board[i][1] == '.') {
+	if(get_piece(game, i, 1) != '.' && 
+		get_piece(game, i, width - 1) == '.' && 
+		get_piece(game, i, 0) == '.') {
 	    if(lower_right(game, i)) {
-		check_push(game, i, 0);
-		printf("Player %c placed at %d 0\n",
-			game->players[game->turn], i);
-		return;
+		return (Move){i, 0};
 	    }
 	}
     }
-    type1_first_move(game);
+    return type1_first_move(game);
 }
 
-//Check if the interior of the board is full will return 1 if the board 
-//is not full else 0
-int end_game(Game* game) {
-    int endGame = 0;
-    for(int i = 1; i < game->height - 1; i++) {
-	for(int j = 2; j < game->width * 2 - 2; j++) {
-	    if(game->board[i][j] == '.') {
-		endGame = 1;
-	    }
-	}
-    }
-    return endGame;
-}			
-
 //When the game ends calculate the score and the winner of the game
 void do_score(Game* game) {
-    int xScore = 0;
-    int oScore = 0;
-    for(int i = 0; i < game->height; i++) {
-	for(int j = 0; j < game->width * 2; j++) {
-	    if(game->board[i][j] == 'X') {
-		xScore = game->board[i][j - 1] - '0' + xScore;
-	    }
-	    if(game->board[i][j] == 'O') {
-		oScore = game->board[i][j - 1] - '0' + oScore;
-	    }
-	}
-    }
+    int xScore = board_score(game, 'X');
+    int oScore = board_score(game, 'O');
     if(xScore > oScore) {
 	printf("Winners: X\n");
     } else if(oScore > xScore) {
@@ -595,11 +295,8 @@ void do_score(Game* game) {
     }
 }
 
-//Initialise the game assets
-void init_game_assets(Game* game, char** argv) {
-    game->file = argv[3];
-    read_file(game);
-    is_board_full(game);
+//Set up the players and whose turn it is from the loaded first player
+void init_turn(Game* game) {
     game->p2 = (game->p1 == 'X') ? 'O' : 'X';
     game->players[0] = 'O';
     game->players[1] = 'X';
@@ -610,6 +307,63 @@ void init_game_assets(Game* game, char** argv) {
     }
 }
 
+//Read the search player option at argv[i] into the settings:
+//  -l millis	    time limit for each move
+//  -m megabytes    memory for the transposition table or search tree
+//  -p playouts	    playouts for each move of type 3 in place of -l
+//  -D depth	    depth type 2 searches each move to in place of -l
+//  -j threads	    threads type 2 or 3 searches on
+//  -B tablebase    tablebase type 2 or 3 plays from when it can
+//Return the number of arguments used, or 0 if argv[i] is not one of these
+//options. Exit with the usage status if the option's value is not valid.
+int read_setting(Settings* settings, int argc, char** argv, int i,
+	Status usage) {
+    int* setting;
+    if(!strcmp(argv[i], "-l")) {
+	setting = &settings->moveMillis;
+    } else if(!strcmp(argv[i], "-m")) {
+	setting = &settings->tableMegabytes;
+    } else if(!strcmp(argv[i], "-p")) {
+	setting = &settings->playouts;
+    } else if(!strcmp(argv[i], "-j")) {
+	setting = &settings->threads;
+    } else if(!strcmp(argv[i], "-D")) {
+	setting = &settings->depth;
+    } else if(!strcmp(argv[i], "-B")) {
+	if(i + 1 >= argc) {
+	    exit_status(usage);
+	}
+	settings->tablebase = argv[i + 1];
+	return 2;
+    } else {
+	return 0;
+    }
+    if(i + 1 >= argc) {
+	exit_status(usage);
+    }
+    char* err;
+    long value = strtol(argv[i + 1], &err, 10);
+    if(argv[i + 1][0] == '\0' || *err != '\0' || value < 1 ||
+	    value > INT_MAX) {
+	exit_status(usage);
+    }
+    *setting = value;
+    return 2;
+}
+
+//Initialise the game assets
+void init_game_assets(Game* game, char** argv) {
+    game->file = argv[3];
+    Status status = read_file(game);
+    if(status == OK) {
+	status = is_board_full(game);
+    }
+    if(status != OK) {
+	exit_status(status);
+    }
+    init_turn(game);
+}
+
 //Check the validity of user input arguement. If an incorrect arguement 
 //is found the game will exit, else return 1
 int check_args(Game* game, int argc, char** argv) {
@@ -617,15 +371,12 @@ int check_args(Game* game, int argc, char** argv) {
 	exit_status(INCORRECTARGS);
     }
     for(int i = 0; i < 2; i++) {
-	if(!strcmp(argv[1 + i], "H")) {
-	    game->pType[i] = 'H';
-	} else if(!strcmp(argv[1 + i], "0")) {
-	    game->pType[i] = '0';
-	} else if(!strcmp(argv[1 + i], "1")) {
-	    game->pType[i] = '1';
-	} else {
+	const Strategy* strategy = find_strategy(argv[1 + i]);
+	if(strategy == NULL) {
 	    exit_status(BADPLAYER);
 	}
+	game->strategy[i] = strategy;
+	game->pType[i] = strategy->type;
     }
     return 1;
 }
@@ -635,28 +386,139 @@ void update_turn(Game* game) {
     game->turn = (game->turn + 1) % 2; //Turn will be 0 or 1
 }
 
-//Start the game. Depending on the type of player will change the type of 
-//move made
+//The player types. A new strategy only needs an entry here.
+const Strategy strategies[] = {
+    {'H', human_move, NULL, 0},
+    {'0', type0_move, NULL, 0},
+    {'1', type1_move, NULL, 0},
+    {'2', search_move, evaluate_positions, 1},
+    {'3', mcts_move, NULL, 1}
+};
+
+//Return the strategy of the player type named by an argument, or NULL if
+//there is no such type
+const Strategy* find_strategy(const char* name) {
+    if(name[0] == '\0' || name[1] != '\0') {
+	return NULL;
+    }
+    for(int i = 0; i < sizeof(strategies) / sizeof(strategies[0]); i++) {
+	if(strategies[i].type == name[0]) {
+	    return &strategies[i];
+	}
+    }
+    return NULL;
+}
+
+//Get the move of the player whose turn it is from its strategy. Players
+//that use the book play the tablebase move when the position is in it.
+Move next_move(Game* game) {
+    const Strategy* strategy = game->strategy[game->turn];
+    Move move;
+    if(strategy->book && game->tablebase &&
+	    tablebase_move(game->tablebase, game, &move)) {
+	return move;
+    }
+    return strategy->move(game);
+}
+
+//Start the game. The current player makes a move, automated players
+//report where they played, and the board is printed.
 void start_game(Game* game) {
-    switch(game->pType[game->turn]) {
-	case 'H':
-	    human_move(game);
-	    break;
-	case '0':
-	    type0_move(game);
-	    break;
-	case '1':
-	    type1_move(game);
-	    break;
+    Move move = next_move(game);
+    Undo undo = check_push(game, move.row, move.col); //check for push
+    if(game->log) {
+	log_move(game, move, undo);
+    }
+    if(game->pType[game->turn] != 'H') {
+	printf("Player %c placed at %d %d\n", game->players[game->turn],
+		move.row, move.col);
     }
     print_board(game);
     update_turn(game);
 }
 
+//Play the game to the end without printing anything. Return the final
+//scores and the number of moves made.
+Result play_game(Game* game) {
+    Result result = {0, 0, 0};
+    while(end_game(game)) {
+	Move move = next_move(game);
+	check_push(game, move.row, move.col);
+	update_turn(game);
+	result.moves++;
+    }
+    result.oScore = board_score(game, 'O');
+    result.xScore = board_score(game, 'X');
+    return result;
+}
+
+//  push2310 [-o logfile] [-d | -q] [-l millis] [-m megabytes]
+//	    [-p playouts] [-D depth] [-j threads] [-B tablebase]
+//	    typeO typeX fname
+//-o writes every move to a move log that -R can replay. -d shows only the
+//board rows changed by each move and -q doesn't show the board at all. The
+//other options only matter to the search players (types 2 and 3).
 int main(int argc, char** argv) {
-    Game* game = malloc(sizeof(Game));
+    if(argc > 1 && !strcmp(argv[1], "-b")) {
+	return run_batch(argc, argv);
+    }
+    if(argc > 1 && !strcmp(argv[1], "-R")) {
+	return run_replay(argc, argv);
+    }
+    if(argc > 1 && !strcmp(argv[1], "-P")) {
+	return run_perft(argc, argv);
+    }
+    if(argc > 1 && !strcmp(argv[1], "-T")) {
+	return run_tablebase(argc, argv);
+    }
+    if(argc > 1 && !strcmp(argv[1], "-Z")) {
+	return run_stress(argc, argv);
+    }
+    if(argc > 1 && !strcmp(argv[1], "-S")) {
+	return run_server(argc, argv);
+    }
+    Settings settings = {DEFAULT_MILLIS, DEFAULT_MEGABYTES, 0, 1, 0, NULL};
+    char* logName = NULL;
+    Display display = FULL;
+    while(argc > 1) {
+	int used = read_setting(&settings, argc, argv, 1, INCORRECTARGS);
+	if(!used && !strcmp(argv[1], "-o")) {
+	    if(argc < 3) {
+		exit_status(INCORRECTARGS);
+	    }
+	    logName = argv[2];
+	    used = 2;
+	} else if(!used && !strcmp(argv[1], "-d")) {
+	    display = CHANGES;
+	    used = 1;
+	} else if(!used && !strcmp(argv[1], "-q")) {
+	    display = QUIET;
+	    used = 1;
+	}
+	if(!used) {
+	    break;
+	}
+	argc -= used;
+	argv += used;
+    }
+    Game* game = calloc(1, sizeof(Game));
+    game->display = display;
     check_args(game, argc, argv);
     init_game_assets(game, argv);
+    if(logName && !(game->log = fopen(logName, "w"))) {
+	exit_status(BADLOG);
+    }
+    if(settings.tablebase &&
+	    !(game->tablebase = open_tablebase(settings.tablebase))) {
+	exit_status(BADTABLE);
+    }
+    if(game->pType[0] == '2' || game->pType[1] == '2') {
+	game->search = create_search(&settings);
+	new_search_game(game->search);
+    }
+    if(game->pType[0] == '3' || game->pType[1] == '3') {
+	game->mcts = create_mcts(&settings);
+    }
     print_board(game);
     while(1) {
 	start_game(game);
@@ -0,0 +1,264 @@
+#ifndef PUSH2310_H
+#define PUSH2310_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+
+typedef enum {
+    OK = 0,
+    INCORRECTARGS = 1,
+    BADPLAYER = 2,
+    BADFILE = 3,
+    BADSAVE = 4,
+    ENDOFFILE = 5,
+    FULLBOARD = 6,
+    BATCHARGS = 7,
+    BADLOG = 8,
+    REPLAYARGS = 9,
+    PERFTARGS = 10,
+    BADPERFT = 11,
+    TABLEARGS = 12,
+    BADTABLE = 13,
+    SERVERARGS = 14,
+    BADSOCKET = 15,
+    BADRECORD = 16,
+    STRESSARGS = 17,
+    BADSTRESS = 18
+} Status;
+
+#define DEFAULT_MILLIS 1000
+#define DEFAULT_MEGABYTES 64
+
+//How the board is shown after each move: in full, only the rows that
+//changed since it was last shown, or not at all
+typedef enum {
+    FULL = 0,
+    CHANGES = 1,
+    QUIET = 2
+} Display;
+
+typedef struct Search Search;
+typedef struct Mcts Mcts;
+typedef struct Tablebase Tablebase;
+typedef struct Strategy Strategy;
+typedef struct Recorder Recorder;
+typedef struct Record Record;
+
+//Limits of the search players (types 2 and 3): the time each may take for
+//a move and the memory for its table or tree. depth, when not 0, fixes
+//how deep type 2 searches in place of the time limit and playouts how
+//many playouts type 3 runs. threads is how many threads either runs on.
+//tablebase, if not NULL, names a tablebase both look positions up in
+//before searching.
+typedef struct Settings {
+    int moveMillis;
+    int tableMegabytes;
+    int playouts;
+    int threads;
+    int depth;
+    char* tablebase;
+} Settings;
+
+//The board is held as bit planes indexed by cell (row * width + col).
+//A cell is in exactly one of xBits, oBits or emptyBits unless it is a
+//corner, which is in none of them. emptyCols mirrors emptyBits in column
+//major order (col * height + row) so column scans are also word scans.
+//legalBits holds every cell a piece may be placed in, and rowEmpty and
+//colEmpty count the vacant cells of each row and column.
+//All planes, counts and the value array live in one allocation starting
+//at xBits.
+//xScore, oScore, emptyInterior and the Zobrist hash of the pieces are kept
+//up to date as pieces are placed and pushed so they never need a rescan.
+//layout is the tablebase key of the cell values, 0 until it is worked out.
+//strategy is how each player picks its moves.
+//search and mcts are the state of the search players (types 2 and 3) if
+//the game has them, tablebase the tablebase they share, and log the move
+//log being written, if any. text holds the board rendered as its save
+//file rows and shown the rows as they were last printed.
+typedef struct Game {
+    int height;
+    int width;
+    int turn;
+    char p1;
+    char p2;
+    char players[2];
+    char pType[2];
+    const Strategy* strategy[2];
+    char* file;
+    int cells;
+    int words;
+    uint64_t* xBits;
+    uint64_t* oBits;
+    uint64_t* emptyBits;
+    uint64_t* emptyCols;
+    uint64_t* legalBits;
+    uint64_t* interior;
+    int* rowEmpty;
+    int* colEmpty;
+    unsigned char* values;
+    int xScore;
+    int oScore;
+    int emptyInterior;
+    uint64_t hash;
+    uint64_t layout;
+    Search* search;
+    Mcts* mcts;
+    Tablebase* tablebase;
+    FILE* log;
+    Display display;
+    char* text;
+    char* shown;
+    size_t textSize;
+} Game;
+
+typedef struct Move {
+    int row;
+    int col;
+} Move;
+
+//A move as made by check_push: the cell the new piece went in (from), the
+//vacant cell the push filled (to) and the step between cells on the line
+//pushed along. step is 0 when nothing was pushed.
+typedef struct Undo {
+    int from;
+    int to;
+    int step;
+} Undo;
+
+//A player type: how it picks its move, whether it plays from the
+//tablebase when it can (book) and, for players that search, how it scores
+//positions in bulk. evaluate_positions, if not NULL, scores the position
+//reached by each of count moves from the game's position the way evaluate
+//does, for the player to move there, and leaves the game as it was.
+struct Strategy {
+    char type;
+    Move (*move)(Game* game);
+    void (*evaluate_positions)(Game* game, const int* moves, int count,
+	    int* values);
+    int book;
+};
+
+//How random boards are made: the size, the range of interior cell values
+//and the percentage of interior cells that start with a piece
+typedef struct Shape {
+    int height;
+    int width;
+    int low;
+    int high;
+    int fill;
+} Shape;
+
+//Final scores of a game played through without printing
+typedef struct Result {
+    int oScore;
+    int xScore;
+    int moves;
+} Result;
+
+//push2310.c
+const char* status_message(Status s);
+Status exit_status(Status s);
+void init_turn(Game* game);
+void update_turn(Game* game);
+void do_score(Game* game);
+int read_setting(Settings* settings, int argc, char** argv, int i,
+	Status usage);
+const Strategy* find_strategy(const char* name);
+Move next_move(Game* game);
+int read_number(char** text);
+Result play_game(Game* game);
+
+//batch.c
+double now(void);
+int run_batch(int argc, char** argv);
+
+//search.c
+Search* create_search(Settings* settings);
+void free_search(Search* search);
+void new_search_game(Search* search);
+int evaluate(Game* game);
+Undo make_move(Game* game, int cell);
+void unmake_move(Game* game, Undo undo);
+void evaluate_positions(Game* game, const int* moves, int count,
+	int* values);
+Move search_move(Game* game);
+
+//mcts.c
+Mcts* create_mcts(Settings* settings);
+void free_mcts(Mcts* mcts);
+Move mcts_move(Game* game);
+
+//board.c
+int get_bit(const uint64_t* bits, int i);
+int first_bit(const uint64_t* bits, int start, int end);
+int last_bit(const uint64_t* bits, int start, int end);
+void create_board(Game* game);
+size_t board_bytes(Game* game);
+void copy_board(Game* dest, Game* src);
+uint64_t next_random(uint64_t* state);
+void generate_board(Game* game, Shape* shape, uint64_t* state);
+char* next_line(char** text, char* end);
+char* read_contents(char* fileName, size_t* size);
+Status read_file(Game* game);
+int write_save(Game* game, const char* name);
+size_t render_board(Game* game);
+void print_board(Game* game);
+int is_corner(Game* game, int row, int col);
+void put_piece(Game* game, int i, char piece);
+char piece_at(Game* game, int i);
+char get_piece(Game* game, int row, int col);
+int get_value(Game* game, int row, int col);
+Status is_board_full(Game* game);
+int can_place(Game* game, int row, int col);
+int can_push(Game* game, int row, int col);
+int legal_move(Game* game, int row, int col);
+Undo plan_move(Game* game, int row, int col);
+Undo check_push(Game* game, int row, int col);
+void undo_push(Game* game, Undo undo);
+int legal_moves(Game* game, int* list);
+int end_game(Game* game);
+int board_score(Game* game, char piece);
+int first_empty(Game* game);
+int last_empty(Game* game);
+Move cell_move(Game* game, int cell);
+
+//scan.c
+int best_empty(Game* game);
+
+//binary.c
+int is_binary_name(const char* fileName);
+void put_word(unsigned char* out, uint32_t word);
+void pack_pieces(Game* game, unsigned char* out);
+void pack_values(Game* game, unsigned char* out);
+int save_binary(Game* game, const char* fileName);
+int is_binary_save(const char* contents, size_t size);
+Status load_binary(Game* game, const char* contents, size_t size);
+
+//replay.c
+void log_move(Game* game, Move move, Undo undo);
+int run_replay(int argc, char** argv);
+
+//perft.c
+int run_perft(int argc, char** argv);
+
+//tablebase.c
+Tablebase* open_tablebase(const char* fileName);
+void close_tablebase(Tablebase* table);
+int tablebase_move(Tablebase* table, Game* game, Move* move);
+int run_tablebase(int argc, char** argv);
+
+//record.c
+Recorder* open_recorder(const char* fileName);
+int close_recorder(Recorder* recorder);
+Record* create_record(Recorder* recorder);
+void free_record(Record* record);
+Result record_game(Game* game, Record* record);
+
+//stress.c
+int run_stress(int argc, char** argv);
+
+//server.c
+int run_server(int argc, char** argv);
+
+#endif
@@ -0,0 +1,139 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "push2310.h"
+
+#define RECORD_VERSION 1
+#define GAME_BYTES 20
+#define FLUSH_BYTES (1 << 20)
+
+//The self-play record file. All numbers are little endian.
+//  bytes 0-3	    magic "P23R"
+//  byte 4	    version
+//then a block for each game:
+//  bytes 0-3	    height
+//  bytes 4-7	    width
+//  bytes 8-11	    number of positions
+//  bytes 12-15	    final score of O
+//  bytes 16-19	    final score of X
+//  then	    4 bits a cell for the value, two cells a byte
+//  then for each position, in the order they were played from:
+//	byte 0	    player to move ('X' or 'O')
+//	bytes 1-4   cell of the move played (row * width + col)
+//	then	    2 bits a cell for the piece, four cells a byte
+//Cells are packed as in a binary save.
+const char recordMagic[5] = {'P', '2', '3', 'R', RECORD_VERSION};
+
+//A record file shared by every thread of a batch. Threads add whole games
+//at a time under the lock.
+struct Recorder {
+    FILE* file;
+    pthread_mutex_t lock;
+    int failed;
+};
+
+//The games one thread has recorded but not yet written
+struct Record {
+    Recorder* recorder;
+    unsigned char* bytes;
+    size_t used;
+    size_t size;
+};
+
+//Create a record file and write its header. Return NULL if it can't be
+//created.
+Recorder* open_recorder(const char* fileName) {
+    FILE* file = fopen(fileName, "w");
+    if(file == NULL) {
+	return NULL;
+    }
+    Recorder* recorder = calloc(1, sizeof(Recorder));
+    recorder->file = file;
+    pthread_mutex_init(&recorder->lock, NULL);
+    recorder->failed = fwrite(recordMagic, sizeof(recordMagic), 1,
+	    file) != 1;
+    return recorder;
+}
+
+//Close a record file. Return 0 if any of it could not be written.
+int close_recorder(Recorder* recorder) {
+    int written = !recorder->failed;
+    written &= fclose(recorder->file) == 0;
+    pthread_mutex_destroy(&recorder->lock);
+    free(recorder);
+    return written;
+}
+
+//Create a thread's buffer of games for a record file
+Record* create_record(Recorder* recorder) {
+    Record* record = calloc(1, sizeof(Record));
+    record->recorder = recorder;
+    return record;
+}
+
+//Write the buffered games to the record file
+void flush_record(Record* record) {
+    Recorder* recorder = record->recorder;
+    pthread_mutex_lock(&recorder->lock);
+    if(record->used &&
+	    fwrite(record->bytes, record->used, 1, recorder->file) != 1) {
+	recorder->failed = 1;
+    }
+    pthread_mutex_unlock(&recorder->lock);
+    record->used = 0;
+}
+
+//Write what is left of a thread's games and free its buffer
+void free_record(Record* record) {
+    flush_record(record);
+    free(record->bytes);
+    free(record);
+}
+
+//Return room for the given number of bytes at the end of the buffer
+unsigned char* reserve_record(Record* record, size_t bytes) {
+    if(record->used + bytes > record->size) {
+	while(record->used + bytes > record->size) {
+	    record->size = record->size ? record->size * 2 : FLUSH_BYTES;
+	}
+	record->bytes = realloc(record->bytes, record->size);
+    }
+    return record->bytes + record->used;
+}
+
+//Play the game to the end like play_game, adding every position, the move
+//played from it and the final scores to the thread's record. The record
+//is written out once it has grown past FLUSH_BYTES.
+Result record_game(Game* game, Record* record) {
+    Result result = {0, 0, 0};
+    size_t start = record->used;
+    size_t valueBytes = (game->cells + 1) / 2;
+    size_t pieceBytes = (game->cells + 3) / 4;
+    pack_values(game, reserve_record(record, GAME_BYTES + valueBytes) +
+	    GAME_BYTES);
+    record->used += GAME_BYTES + valueBytes;
+    while(end_game(game)) {
+	Move move = next_move(game);
+	unsigned char* out = reserve_record(record, 5 + pieceBytes);
+	out[0] = game->players[game->turn];
+	put_word(out + 1, move.row * game->width + move.col);
+	pack_pieces(game, out + 5);
+	record->used += 5 + pieceBytes;
+	check_push(game, move.row, move.col);
+	update_turn(game);
+	result.moves++;
+    }
+    result.oScore = board_score(game, 'O');
+    result.xScore = board_score(game, 'X');
+    unsigned char* header = record->bytes + start;
+    put_word(header, game->height);
+    put_word(header + 4, game->width);
+    put_word(header + 8, result.moves);
+    put_word(header + 12, result.oScore);
+    put_word(header + 16, result.xScore);
+    if(record->used >= FLUSH_BYTES) {
+	flush_record(record);
+    }
+    return result;
+}
@@ -0,0 +1,144 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "push2310.h"
+
+//A move read back from a move log
+typedef struct Logged {
+    char player;
+    int row;
+    int col;
+    char push;
+} Logged;
+
+//Return the direction a move pushed in as it is written in the move log:
+//'D'own, 'U'p, 'R'ight, 'L'eft, or '-' when nothing was pushed
+char push_direction(Game* game, Undo undo) {
+    if(undo.step == game->width) {
+	return 'D';
+    } else if(undo.step == -game->width) {
+	return 'U';
+    } else if(undo.step == 1) {
+	return 'R';
+    } else if(undo.step == -1) {
+	return 'L';
+    }
+    return '-';
+}
+
+//Add a move made by the player whose turn it is to the game's move log.
+//Each move is one line: player, row, column and push direction.
+void log_move(Game* game, Move move, Undo undo) {
+    fprintf(game->log, "%c %d %d %c\n", game->players[game->turn],
+	    move.row, move.col, push_direction(game, undo));
+}
+
+//Read one move log line: a player, a row and a column of digits only and
+//a push direction, each after a single space. Return 0 if it is not valid.
+int read_logged(char* line, Logged* logged) {
+    if(line[0] == '\0' || line[1] != ' ') {
+	return 0;
+    }
+    char* text = line + 2;
+    logged->player = line[0];
+    logged->row = read_number(&text);
+    if(logged->row < 0 || *text++ != ' ') {
+	return 0;
+    }
+    logged->col = read_number(&text);
+    if(logged->col < 0 || *text++ != ' ' || !strchr("DURL-", *text) ||
+	    *text == '\0' || text[1] != '\0') {
+	return 0;
+    }
+    logged->push = *text;
+    return 1;
+}
+
+//Read every move of a move log. Return the number read or -1 if the log
+//can't be read or a line is not valid.
+long read_log(char* fileName, Logged** moves) {
+    size_t size;
+    char* contents = read_contents(fileName, &size);
+    if(contents == NULL) {
+	return -1;
+    }
+    long count = 0;
+    long room = 64;
+    char* text = contents;
+    char* end = contents + size;
+    char* line;
+    Logged logged;
+    *moves = malloc(sizeof(Logged) * room);
+    while((line = next_line(&text, end))) {
+	if(!read_logged(line, &logged)) {
+	    count = -1;
+	    break;
+	}
+	if(count == room) {
+	    room *= 2;
+	    *moves = realloc(*moves, sizeof(Logged) * room);
+	}
+	(*moves)[count++] = logged;
+    }
+    free(contents);
+    return count;
+}
+
+//Apply the logged moves to the game without printing. Return BADLOG if a
+//move is out of turn, not legal or did not push the way the log says.
+Status replay_moves(Game* game, Logged* moves, long count) {
+    for(long i = 0; i < count; i++) {
+	Logged* logged = &moves[i];
+	if(!end_game(game) || logged->player != game->players[game->turn] ||
+		!legal_move(game, logged->row, logged->col)) {
+	    return BADLOG;
+	}
+	Undo undo = check_push(game, logged->row, logged->col);
+	if(push_direction(game, undo) != logged->push) {
+	    return BADLOG;
+	}
+	update_turn(game);
+    }
+    return OK;
+}
+
+//Replay a move log on the board it was played from and show the board
+//reached, how fast the moves were applied and the winners if it ended.
+//  push2310 -R fname logfile
+int run_replay(int argc, char** argv) {
+    if(argc != 4) {
+	exit_status(REPLAYARGS);
+    }
+    Game* game = calloc(1, sizeof(Game));
+    game->file = argv[2];
+    Status status = read_file(game);
+    if(status == OK) {
+	status = is_board_full(game);
+    }
+    if(status != OK) {
+	exit_status(status);
+    }
+    init_turn(game);
+    Logged* moves;
+    long count = read_log(argv[3], &moves);
+    if(count < 0) {
+	exit_status(BADLOG);
+    }
+    double start = now();
+    status = replay_moves(game, moves, count);
+    double seconds = now() - start;
+    if(status != OK) {
+	exit_status(status);
+    }
+    print_board(game);
+    printf("Replayed %ld moves in %.3fs, %.0f moves/s\n", count, seconds,
+	    seconds > 0 ? count / seconds : 0.0);
+    if(!end_game(game)) {
+	do_score(game);
+    }
+    free(moves);
+    free(game->text);
+    free(game->xBits);
+    free(game);
+    return OK;
+}
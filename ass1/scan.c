@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "push2310.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define X86_KERNELS
+#endif
+
+#define MAX_VALUE 9
+
+//Return the first cell of a 64 cell block that is set in the mask and
+//holds the highest value above floor, or -1 if no cell in the mask holds
+//a value above floor. values is the first cell of the block.
+typedef int (*BlockKernel)(const unsigned char* values, uint64_t mask,
+	int floor);
+
+//Scalar kernel. Only reads the cells in the mask so it is also used for
+//the last block of a board, which may not have 64 cells.
+int block_best_scalar(const unsigned char* values, uint64_t mask,
+	int floor) {
+    int best = -1;
+    while(mask) {
+	int i = __builtin_ctzll(mask);
+	if(values[i] > floor) {
+	    floor = values[i];
+	    best = i;
+	}
+	mask &= mask - 1;
+    }
+    return best;
+}
+
+#ifdef X86_KERNELS
+//SSE2 kernel. The block is loaded once, then compared against each value
+//from the highest down: the first value with a cell in the mask is the
+//best and the lowest bit of the match is its first cell.
+__attribute__((target("sse2")))
+int block_best_sse2(const unsigned char* values, uint64_t mask, int floor) {
+    __m128i lanes[4];
+    for(int i = 0; i < 4; i++) {
+	lanes[i] = _mm_loadu_si128((const __m128i*)(values + i * 16));
+    }
+    for(int v = MAX_VALUE; v > floor; v--) {
+	__m128i value = _mm_set1_epi8(v);
+	uint64_t hits = 0;
+	for(int i = 0; i < 4; i++) {
+	    hits |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+		    _mm_cmpeq_epi8(lanes[i], value)) << (i * 16);
+	}
+	if(hits & mask) {
+	    return __builtin_ctzll(hits & mask);
+	}
+    }
+    return -1;
+}
+
+//AVX2 kernel, the same as the SSE2 one over two 32 byte lanes
+__attribute__((target("avx2")))
+int block_best_avx2(const unsigned char* values, uint64_t mask, int floor) {
+    __m256i low = _mm256_loadu_si256((const __m256i*)values);
+    __m256i high = _mm256_loadu_si256((const __m256i*)(values + 32));
+    for(int v = MAX_VALUE; v > floor; v--) {
+	__m256i value = _mm256_set1_epi8(v);
+	uint64_t hits = (uint32_t)_mm256_movemask_epi8(
+		_mm256_cmpeq_epi8(low, value)) |
+		(uint64_t)(uint32_t)_mm256_movemask_epi8(
+		_mm256_cmpeq_epi8(high, value)) << 32;
+	if(hits & mask) {
+	    return __builtin_ctzll(hits & mask);
+	}
+    }
+    return -1;
+}
+#endif
+
+BlockKernel blockBest = block_best_scalar;
+pthread_once_t kernelsChosen = PTHREAD_ONCE_INIT;
+
+//Pick the widest kernel the processor supports
+void choose_kernels(void) {
+#ifdef X86_KERNELS
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) {
+	blockBest = block_best_avx2;
+    } else if(__builtin_cpu_supports("sse2")) {
+	blockBest = block_best_sse2;
+    }
+#endif
+}
+
+//Return the vacant interior cell with the highest value. Ties go to the
+//first cell scanning from the top left. Return -1 if there is none.
+//Whole 64 cell blocks are scanned by the vector kernel; the values array
+//is only padded to 8 cells so a partial last block is scanned a cell at a
+//time.
+int best_empty(Game* game) {
+    pthread_once(&kernelsChosen, choose_kernels);
+    int best = -1;
+    int bestValue = -1;
+    for(int w = 0; w < game->words && bestValue < MAX_VALUE; w++) {
+	uint64_t mask = game->emptyBits[w] & game->interior[w];
+	if(!mask) {
+	    continue;
+	}
+	BlockKernel kernel = ((w + 1) * 64 <= game->cells) ? blockBest :
+		block_best_scalar;
+	int i = kernel(game->values + w * 64, mask, bestValue);
+	if(i >= 0) {
+	    best = w * 64 + i;
+	    bestValue = game->values[best];
+	}
+    }
+    return best;
+}
@@ -0,0 +1,406 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include "push2310.h"
+
+#define MAX_PLY 64
+#define CHECK_NODES 1024
+#define INFINITE INT_MAX
+#define NO_MOVE ((1 << 24) - 1)
+
+typedef enum {
+    EXACT = 0,
+    LOWER = 1,
+    UPPER = 2
+} Bound;
+
+//A transposition table entry shared by every search thread without
+//locking. data packs the value (32 bits), best move cell (24 bits), depth
+//(6 bits) and bound (2 bits) of a position, and check is its key xor data.
+//A reader only uses an entry when check xor data gives back the key it is
+//after, so an entry half written by another thread is just a miss.
+typedef struct Entry {
+    uint64_t check;
+    uint64_t data;
+} Entry;
+
+//One thread of the search. Each plays on its own copy of the board with
+//its own move list for each ply, and room for the values of a batch of
+//leaf positions.
+typedef struct Searcher {
+    pthread_t thread;
+    struct Search* search;
+    Game* game;
+    int* moves[MAX_PLY];
+    int* values;
+    int listSize;
+    long nodes;
+} Searcher;
+
+//State of the type 2 search player. The table is sized from a memory
+//budget and kept between moves of the same game. salt is folded into
+//every key and changed for each new game so entries left from a game on a
+//different board never match. Each depth of the search is split at the
+//root: threads take root moves in turn from next and keep the best value
+//and move found so far in best, packed so both change in one atomic step.
+//evaluate is the searching player's bulk evaluation, if it has one, used
+//to score all the leaves under a node one ply from the horizon at once.
+struct Search {
+    void (*evaluate)(Game* game, const int* moves, int count, int* values);
+    int moveMillis;
+    int depth;
+    int threads;
+    Entry* table;
+    uint64_t mask;
+    uint64_t salt;
+    Searcher* pool;
+    double deadline;
+    int stopped;
+    int* rootMoves;
+    int rootCount;
+    int next;
+    int rootDepth;
+    uint64_t best;
+};
+
+//Create a search player with the given time limit per move, search
+//depth, threads and memory budget for the transposition table. The table
+//has the largest power of two number of entries that fits in the budget.
+Search* create_search(Settings* settings) {
+    Search* search = calloc(1, sizeof(Search));
+    uint64_t entries = 1;
+    uint64_t budget = (uint64_t)settings->tableMegabytes << 20;
+    while(entries * 2 * sizeof(Entry) <= budget) {
+	entries *= 2;
+    }
+    search->moveMillis = settings->moveMillis;
+    search->depth = settings->depth;
+    search->threads = settings->threads;
+    search->table = calloc(entries, sizeof(Entry));
+    search->mask = entries - 1;
+    search->pool = calloc(search->threads, sizeof(Searcher));
+    for(int i = 0; i < search->threads; i++) {
+	search->pool[i].search = search;
+	search->pool[i].game = calloc(1, sizeof(Game));
+    }
+    return search;
+}
+
+//Free a search player
+void free_search(Search* search) {
+    for(int i = 0; i < search->threads; i++) {
+	for(int j = 0; j < MAX_PLY; j++) {
+	    free(search->pool[i].moves[j]);
+	}
+	free(search->pool[i].values);
+	free(search->pool[i].game->xBits);
+	free(search->pool[i].game);
+    }
+    free(search->pool);
+    free(search->rootMoves);
+    free(search->table);
+    free(search);
+}
+
+//Get the search ready for a new game. Entries from earlier games are
+//left in the table but can no longer match.
+void new_search_game(Search* search) {
+    search->salt = next_random(&search->salt);
+}
+
+//Make sure every ply has room for a move in each cell of the board
+void size_move_lists(Searcher* searcher, Game* game) {
+    if(searcher->listSize >= game->cells) {
+	return;
+    }
+    for(int i = 0; i < MAX_PLY; i++) {
+	free(searcher->moves[i]);
+	searcher->moves[i] = malloc(sizeof(int) * game->cells);
+    }
+    free(searcher->values);
+    searcher->values = malloc(sizeof(int) * game->cells);
+    searcher->listSize = game->cells;
+}
+
+//Return the score of the player to move less the score of the other
+//player. Once the interior is full this is the final result.
+int evaluate(Game* game) {
+    int diff = game->oScore - game->xScore;
+    return (game->players[game->turn] == 'O') ? diff : -diff;
+}
+
+//Make the move in the given cell and pass the turn
+Undo make_move(Game* game, int cell) {
+    Undo undo = check_push(game, cell / game->width, cell % game->width);
+    update_turn(game);
+    return undo;
+}
+
+//Take back a move made by make_move
+void unmake_move(Game* game, Undo undo) {
+    update_turn(game);
+    undo_push(game, undo);
+}
+
+//Score the position reached by each move for the player to move there,
+//as evaluate does, without making the moves. A move scores the value of
+//the cell its piece goes in, and every piece it pushes scores the value
+//of the cell it is pushed into in place of the one it left.
+void evaluate_positions(Game* game, const int* moves, int count,
+	int* values) {
+    int mover = game->players[game->turn] == 'O';
+    uint64_t* moverBits = mover ? game->oBits : game->xBits;
+    int scores[2] = {game->xScore, game->oScore};
+    for(int i = 0; i < count; i++) {
+	Undo plan = plan_move(game, moves[i] / game->width,
+		moves[i] % game->width);
+	int gain[2] = {0, 0};
+	gain[mover] = game->values[plan.from];
+	for(int c = plan.to; c != plan.from; c -= plan.step) {
+	    int owner = get_bit(moverBits, c - plan.step) ? mover : !mover;
+	    gain[owner] += game->values[c] - game->values[c - plan.step];
+	}
+	values[i] = (scores[!mover] + gain[!mover]) -
+		(scores[mover] + gain[mover]);
+    }
+}
+
+//Return the key of the position for the table, including whose turn it is
+uint64_t position_key(Game* game, Search* search) {
+    return game->hash ^ search->salt ^ (game->turn ? 0x5A17ULL : 0);
+}
+
+//Look a position up in the table. Return 0 if it is not there.
+int probe(Search* search, uint64_t key, int* value, int* best, int* depth,
+	int* bound) {
+    Entry* entry = &search->table[key & search->mask];
+    uint64_t check = __atomic_load_n(&entry->check, __ATOMIC_RELAXED);
+    uint64_t data = __atomic_load_n(&entry->data, __ATOMIC_RELAXED);
+    if((check ^ data) != key) {
+	return 0;
+    }
+    *value = (int32_t)(data >> 32);
+    *best = (data >> 8) & NO_MOVE;
+    *best = (*best == NO_MOVE) ? -1 : *best;
+    *depth = (data >> 2) & 63;
+    *bound = data & 3;
+    return 1;
+}
+
+//Store what was found about a position in the table
+void store(Search* search, uint64_t key, int value, int best, int depth,
+	int bound) {
+    Entry* entry = &search->table[key & search->mask];
+    uint64_t move = (best < 0 || best >= NO_MOVE) ? NO_MOVE : best;
+    uint64_t data = (uint64_t)(uint32_t)value << 32 | move << 8 |
+	    (uint64_t)depth << 2 | bound;
+    __atomic_store_n(&entry->check, key ^ data, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->data, data, __ATOMIC_RELAXED);
+}
+
+//Return 1 if the search has been stopped
+int is_stopped(Search* search) {
+    return __atomic_load_n(&search->stopped, __ATOMIC_RELAXED);
+}
+
+//Return 1 once the search has run out of time. Searches to a fixed depth
+//never do.
+int out_of_time(Searcher* searcher) {
+    Search* search = searcher->search;
+    if((++searcher->nodes & (CHECK_NODES - 1)) == 0 && !search->depth &&
+	    now() > search->deadline) {
+	__atomic_store_n(&search->stopped, 1, __ATOMIC_RELAXED);
+    }
+    return is_stopped(search);
+}
+
+//Negamax alpha-beta search of the searcher's board to the given depth.
+//Return the value for the player to move. Moves are made and taken back
+//on the one board. One ply from the horizon every child is a leaf, so
+//they are scored in one call to the bulk evaluation when there is one.
+//The search is abandoned when the deadline passes, and the value returned
+//then is not used.
+int negamax(Searcher* searcher, int depth, int alpha, int beta, int ply) {
+    Search* search = searcher->search;
+    Game* game = searcher->game;
+    if(out_of_time(searcher)) {
+	return 0;
+    }
+    if(!end_game(game) || depth == 0 || ply == MAX_PLY - 1) {
+	return evaluate(game);
+    }
+    uint64_t key = position_key(game, search);
+    int hashValue, hashMove = -1, hashDepth, bound;
+    if(probe(search, key, &hashValue, &hashMove, &hashDepth, &bound) &&
+	    hashDepth >= depth) {
+	if(bound == EXACT) {
+	    return hashValue;
+	} else if(bound == LOWER && hashValue > alpha) {
+	    alpha = hashValue;
+	} else if(bound == UPPER && hashValue < beta) {
+	    beta = hashValue;
+	}
+	if(alpha >= beta) {
+	    return hashValue;
+	}
+    }
+    int* list = searcher->moves[ply];
+    int count = legal_moves(game, list);
+    for(int i = 1; i < count; i++) { //try the table's move first
+	if(list[i] == hashMove) {
+	    list[i] = list[0];
+	    list[0] = hashMove;
+	}
+    }
+    int* values = NULL;
+    if(depth == 1 && search->evaluate) {
+	values = searcher->values;
+	search->evaluate(game, list, count, values);
+    }
+    int start = alpha;
+    int bestValue = -INFINITE;
+    int bestMove = list[0];
+    for(int i = 0; i < count; i++) {
+	int value;
+	if(values) {
+	    value = -values[i];
+	} else {
+	    Undo undo = make_move(game, list[i]);
+	    value = -negamax(searcher, depth - 1, -beta, -alpha, ply + 1);
+	    unmake_move(game, undo);
+	    if(is_stopped(search)) {
+		return 0;
+	    }
+	}
+	if(value > bestValue) {
+	    bestValue = value;
+	    bestMove = list[i];
+	}
+	if(value > alpha) {
+	    alpha = value;
+	}
+	if(alpha >= beta) {
+	    break;
+	}
+    }
+    store(search, key, bestValue, bestMove, depth,
+	    (bestValue <= start) ? UPPER :
+	    (bestValue >= beta) ? LOWER : EXACT);
+    return bestValue;
+}
+
+//Pack a root value and move index so that a larger value, then an earlier
+//move, compares higher
+uint64_t pack_best(int value, int index) {
+    return (uint64_t)((uint32_t)value ^ 0x80000000u) << 32 |
+	    (uint32_t)(INT_MAX - index);
+}
+
+//Return the root value packed by pack_best
+int best_value(uint64_t best) {
+    return (int)((uint32_t)(best >> 32) ^ 0x80000000u);
+}
+
+//Return the move index packed by pack_best
+int best_index(uint64_t best) {
+    return INT_MAX - (int)(uint32_t)best;
+}
+
+//Raise the best root result to the given value and move if it is better
+void offer_best(Search* search, int value, int index) {
+    uint64_t offer = pack_best(value, index);
+    uint64_t best = __atomic_load_n(&search->best, __ATOMIC_RELAXED);
+    while(offer > best && !__atomic_compare_exchange_n(&search->best, &best,
+	    offer, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+//Thread start routine. Search root moves taken in turn until none are
+//left. The best value found so far by any thread is the lower bound of
+//each root search, so only moves that might be better are searched in
+//full. Equal values go to the earlier root move, as they would with one
+//thread, so a move before the best so far is searched to find out if it
+//is as good.
+void* search_root(void* arg) {
+    Searcher* searcher = arg;
+    Search* search = searcher->search;
+    int i;
+    while(!is_stopped(search) && (i = __atomic_fetch_add(&search->next, 1,
+	    __ATOMIC_RELAXED)) < search->rootCount) {
+	uint64_t best = __atomic_load_n(&search->best, __ATOMIC_RELAXED);
+	int alpha = (best == 0) ? -INFINITE : best_value(best);
+	if(best != 0 && alpha > -INFINITE && i < best_index(best)) {
+	    alpha--;
+	}
+	Undo undo = make_move(searcher->game, search->rootMoves[i]);
+	int value = -negamax(searcher, search->rootDepth - 1, -INFINITE,
+		(alpha == -INFINITE) ? INFINITE : -alpha, 1);
+	unmake_move(searcher->game, undo);
+	if(!is_stopped(search) && (value > alpha || best == 0)) {
+	    offer_best(search, value, i);
+	}
+    }
+    return NULL;
+}
+
+//Search every root move to the given depth on all the threads. Return
+//the index in rootMoves of the best move, or -1 if time ran out first.
+int search_depth(Search* search, int depth) {
+    search->rootDepth = depth;
+    search->next = 0;
+    search->best = 0;
+    for(int i = 1; i < search->threads; i++) {
+	pthread_create(&search->pool[i].thread, NULL, search_root,
+		&search->pool[i]);
+    }
+    search_root(&search->pool[0]);
+    for(int i = 1; i < search->threads; i++) {
+	pthread_join(search->pool[i].thread, NULL);
+    }
+    if(is_stopped(search)) {
+	return -1;
+    }
+    return best_index(search->best);
+}
+
+//Type 2 automated player. Search deeper and deeper with alpha-beta until
+//the time limit per move runs out, or to the fixed depth if one was given,
+//and play the best move of the deepest search that finished. No game
+//lasts more moves than there are vacant cells, so there is no point
+//searching deeper than that. The best move of each depth is searched first
+//at the next.
+Move search_move(Game* game) {
+    Search* search = game->search;
+    int vacant = 0;
+    for(int w = 0; w < game->words; w++) {
+	vacant += __builtin_popcountll(game->emptyBits[w]);
+    }
+    for(int i = 0; i < search->threads; i++) {
+	size_move_lists(&search->pool[i], game);
+	copy_board(search->pool[i].game, game);
+    }
+    search->rootMoves = realloc(search->rootMoves, sizeof(int) * game->cells);
+    search->rootCount = legal_moves(game, search->rootMoves);
+    search->evaluate = game->strategy[game->turn] ?
+	    game->strategy[game->turn]->evaluate_positions : NULL;
+    search->deadline = now() + search->moveMillis / 1000.0;
+    search->stopped = 0;
+    int last = (search->depth && search->depth < MAX_PLY) ?
+	    search->depth : MAX_PLY - 1;
+    int best = -1;
+    for(int depth = 1; depth <= vacant && depth <= last; depth++) {
+	int index = search_depth(search, depth);
+	if(index < 0) {
+	    break;
+	}
+	best = search->rootMoves[index];
+	search->rootMoves[index] = search->rootMoves[0];
+	search->rootMoves[0] = best;
+    }
+    if(best < 0) { //out of time before one ply was done
+	best = search->rootMoves[0];
+    }
+    return cell_move(game, best);
+}
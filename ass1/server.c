@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include "push2310.h"
+
+#define MAX_EVENTS 64
+#define MAX_LINE 4096
+#define MAX_ID 64
+#define READ_SIZE 4096
+#define MAX_AUTOMATED 2
+
+//The server hosts any number of games, each known by an ID its clients
+//choose, and takes commands from clients on a Unix domain socket. Each
+//command is one line and gets one reply line, "ok ID ..." or
+//"error ID reason":
+//  new ID typeO typeX fname	load a game from a save file
+//  move ID R C			play for the human whose turn it is
+//  play ID			let the automated players carry on
+//  board ID			show the board
+//  save ID fname		save the game
+//  end ID			drop the game
+//new, move and play then let automated players move until it is a
+//human's turn or the game is over. Their replies list every move made as
+//"P R C" and end with "winners P..." once the game is over. Moves are made
+//on the event loop, so to keep a command from holding up every other
+//client it makes at most MAX_AUTOMATED automated moves, each within the
+//search players' limits. If an automated player is still to move after
+//them the reply ends with "more", and play carries on. The board reply
+//gives the height, width and player to move, then the rows of the board as
+//in a save file, one line each. Any client may use any game.
+
+//A game hosted by the server, in a chain of its hash bucket
+typedef struct Hosted {
+    char* id;
+    Game* game;
+    struct Hosted* next;
+} Hosted;
+
+//A connected client. in holds what has been read but not yet run, and out
+//the replies not yet written because the socket was full.
+typedef struct Client {
+    int fd;
+    char* in;
+    size_t inUsed;
+    char* out;
+    size_t outUsed;
+    size_t outSize;
+    int writing;
+    int closed;
+} Client;
+
+//State of the server. Moves are made one at a time on the event loop so
+//the search players (types 2 and 3) are shared by every game. They are
+//only created once a game needs them. searched is the game the search last
+//played in.
+typedef struct Server {
+    int listener;
+    int poll;
+    Hosted** buckets;
+    int bucketCount;
+    int gameCount;
+    Settings settings;
+    Search* search;
+    Mcts* mcts;
+    Tablebase* tablebase;
+    Game* searched;
+} Server;
+
+//Return the FNV-1a hash of a game ID
+uint32_t id_hash(const char* id) {
+    uint32_t hash = 2166136261u;
+    for(; *id; id++) {
+	hash = (hash ^ (unsigned char)*id) * 16777619u;
+    }
+    return hash;
+}
+
+//Return the link that points at the game with the given ID, or the NULL
+//link at the end of its bucket if there is no such game
+Hosted** find_game(Server* server, const char* id) {
+    Hosted** link = &server->buckets[id_hash(id) &
+	    (server->bucketCount - 1)];
+    while(*link && strcmp((*link)->id, id)) {
+	link = &(*link)->next;
+    }
+    return link;
+}
+
+//Double the buckets once there are more games than buckets
+void grow_buckets(Server* server) {
+    if(server->gameCount < server->bucketCount) {
+	return;
+    }
+    Hosted** old = server->buckets;
+    int oldCount = server->bucketCount;
+    server->bucketCount *= 2;
+    server->buckets = calloc(server->bucketCount, sizeof(Hosted*));
+    for(int i = 0; i < oldCount; i++) {
+	while(old[i]) {
+	    Hosted* hosted = old[i];
+	    old[i] = hosted->next;
+	    Hosted** link = &server->buckets[id_hash(hosted->id) &
+		    (server->bucketCount - 1)];
+	    hosted->next = *link;
+	    *link = hosted;
+	}
+    }
+    free(old);
+}
+
+//Free a hosted game
+void free_hosted(Hosted* hosted) {
+    free(hosted->game->xBits);
+    free(hosted->game->text);
+    free(hosted->game->shown);
+    free(hosted->game);
+    free(hosted->id);
+    free(hosted);
+}
+
+//Add text to the client's replies
+void client_write(Client* client, const char* text, size_t length) {
+    if(client->outUsed + length > client->outSize) {
+	while(client->outUsed + length > client->outSize) {
+	    client->outSize = client->outSize ? client->outSize * 2 : 1024;
+	}
+	client->out = realloc(client->out, client->outSize);
+    }
+    memcpy(client->out + client->outUsed, text, length);
+    client->outUsed += length;
+}
+
+//Add formatted text to the client's replies
+void client_printf(Client* client, const char* format, ...)
+	__attribute__((format(printf, 2, 3)));
+
+void client_printf(Client* client, const char* format, ...) {
+    char text[MAX_LINE];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if(length >= (int)sizeof(text)) {
+	length = sizeof(text) - 1;
+    }
+    client_write(client, text, length);
+}
+
+//Make the move for the player whose turn it is and add it to the reply
+void play_move(Client* client, Game* game, Move move) {
+    client_printf(client, " %c %d %d", game->players[game->turn], move.row,
+	    move.col);
+    check_push(game, move.row, move.col);
+    update_turn(game);
+}
+
+//Let automated players move until it is a human's turn or the game is
+//over, or they have made MAX_AUTOMATED moves, then end the reply
+void play_automated(Server* server, Client* client, Game* game) {
+    for(int moves = 0; end_game(game) && game->pType[game->turn] != 'H';
+	    moves++) {
+	if(moves == MAX_AUTOMATED) {
+	    client_printf(client, " more");
+	    break;
+	}
+	if(game->search && server->searched != game) {
+	    new_search_game(game->search);
+	    server->searched = game;
+	}
+	play_move(client, game, next_move(game));
+    }
+    if(!end_game(game)) {
+	int oScore = board_score(game, 'O');
+	int xScore = board_score(game, 'X');
+	client_printf(client, " winners%s%s", (oScore >= xScore) ? " O" : "",
+		(xScore >= oScore) ? " X" : "");
+    }
+    client_write(client, "\n", 1);
+}
+
+//new ID typeO typeX fname
+void command_new(Server* server, Client* client, char* id, char** args,
+	int count) {
+    const Strategy* strategy[2];
+    if(count != 3 || !(strategy[0] = find_strategy(args[0])) ||
+	    !(strategy[1] = find_strategy(args[1]))) {
+	client_printf(client, "error %s bad command\n", id);
+	return;
+    }
+    Hosted** link = find_game(server, id);
+    if(*link) {
+	client_printf(client, "error %s game exists\n", id);
+	return;
+    }
+    Game* game = calloc(1, sizeof(Game));
+    game->file = args[2];
+    Status status = read_file(game);
+    if(status == OK) {
+	status = is_board_full(game);
+    }
+    game->file = NULL;
+    if(status != OK) {
+	free(game->xBits);
+	free(game);
+	client_printf(client, "error %s %s", id, status_message(status));
+	return;
+    }
+    init_turn(game);
+    char types[2];
+    for(int i = 0; i < 2; i++) {
+	game->strategy[i] = strategy[i];
+	game->pType[i] = types[i] = strategy[i]->type;
+    }
+    game->display = QUIET;
+    game->tablebase = server->tablebase;
+    if(types[0] == '2' || types[1] == '2') {
+	if(!server->search) {
+	    server->search = create_search(&server->settings);
+	}
+	game->search = server->search;
+    }
+    if(types[0] == '3' || types[1] == '3') {
+	if(!server->mcts) {
+	    server->mcts = create_mcts(&server->settings);
+	}
+	game->mcts = server->mcts;
+    }
+    Hosted* hosted = malloc(sizeof(Hosted));
+    hosted->id = strdup(id);
+    hosted->game = game;
+    hosted->next = NULL;
+    *link = hosted;
+    server->gameCount++;
+    grow_buckets(server);
+    client_printf(client, "ok %s", id);
+    play_automated(server, client, game);
+}
+
+//move ID R C, checked as strictly as a human's move
+void command_move(Server* server, Client* client, Game* game, char* id,
+	char** args, int count) {
+    char* end1 = count == 2 ? args[0] : "";
+    char* end2 = count == 2 ? args[1] : "";
+    int row = read_number(&end1);
+    int col = read_number(&end2);
+    if(row < 0 || col < 0 || *end1 != '\0' || *end2 != '\0') {
+	client_printf(client, "error %s bad command\n", id);
+    } else if(!end_game(game)) {
+	client_printf(client, "error %s game over\n", id);
+    } else if(game->pType[game->turn] != 'H') {
+	client_printf(client, "error %s not a human's turn\n", id);
+    } else if(!legal_move(game, row, col)) {
+	client_printf(client, "error %s illegal move\n", id);
+    } else {
+	client_printf(client, "ok %s", id);
+	play_move(client, game, (Move){row, col});
+	play_automated(server, client, game);
+    }
+}
+
+//board ID
+void command_board(Client* client, Game* game, char* id) {
+    size_t size = render_board(game);
+    client_printf(client, "ok %s %d %d %c\n", id, game->height, game->width,
+	    game->players[game->turn]);
+    client_write(client, game->text, size);
+}
+
+//Run one command line from a client
+void run_command(Server* server, Client* client, char* line) {
+    char* words[6];
+    int count = 0;
+    char* save;
+    for(char* word = strtok_r(line, " ", &save); word && count < 6;
+	    word = strtok_r(NULL, " ", &save)) {
+	words[count++] = word;
+    }
+    if(count < 2 || strlen(words[1]) > MAX_ID) {
+	client_printf(client, "error - bad command\n");
+	return;
+    }
+    char* id = words[1];
+    if(!strcmp(words[0], "new")) {
+	command_new(server, client, id, words + 2, count - 2);
+	return;
+    }
+    Hosted** link = find_game(server, id);
+    if(!*link) {
+	client_printf(client, "error %s unknown game\n", id);
+    } else if(!strcmp(words[0], "move")) {
+	command_move(server, client, (*link)->game, id, words + 2, count - 2);
+    } else if(!strcmp(words[0], "play") && count == 2) {
+	client_printf(client, "ok %s", id);
+	play_automated(server, client, (*link)->game);
+    } else if(!strcmp(words[0], "board") && count == 2) {
+	command_board(client, (*link)->game, id);
+    } else if(!strcmp(words[0], "save") && count == 3) {
+	if(write_save((*link)->game, words[2])) {
+	    client_printf(client, "ok %s\n", id);
+	} else {
+	    client_printf(client, "error %s save failed\n", id);
+	}
+    } else if(!strcmp(words[0], "end") && count == 2) {
+	Hosted* hosted = *link;
+	*link = hosted->next;
+	if(server->searched == hosted->game) {
+	    server->searched = NULL;
+	}
+	free_hosted(hosted);
+	server->gameCount--;
+	client_printf(client, "ok %s\n", id);
+    } else {
+	client_printf(client, "error %s bad command\n", id);
+    }
+}
+
+//Write as much of the client's replies as the socket will take, and ask
+//to hear when it can take more if any are left. Mark the client closed if
+//it has gone.
+void flush_client(Server* server, Client* client) {
+    size_t sent = 0;
+    while(sent < client->outUsed) {
+	ssize_t wrote = send(client->fd, client->out + sent,
+		client->outUsed - sent, MSG_NOSIGNAL);
+	if(wrote < 0 && errno == EINTR) {
+	    continue;
+	}
+	if(wrote < 0) {
+	    client->closed = (errno != EAGAIN && errno != EWOULDBLOCK);
+	    break;
+	}
+	sent += wrote;
+    }
+    memmove(client->out, client->out + sent, client->outUsed - sent);
+    client->outUsed -= sent;
+    if(client->writing != (client->outUsed > 0)) {
+	client->writing = client->outUsed > 0;
+	struct epoll_event event = {EPOLLIN | (client->writing ? EPOLLOUT : 0),
+		{.ptr = client}};
+	epoll_ctl(server->poll, EPOLL_CTL_MOD, client->fd, &event);
+    }
+}
+
+//Read what the client has sent and run every whole line. A line too long
+//to be a command closes the client.
+void read_client(Server* server, Client* client) {
+    while(!client->closed) {
+	if(client->inUsed > MAX_LINE) {
+	    client->closed = 1;
+	    break;
+	}
+	ssize_t got = read(client->fd, client->in + client->inUsed,
+		READ_SIZE);
+	if(got < 0 && errno == EINTR) {
+	    continue;
+	}
+	if(got <= 0) {
+	    client->closed = !(got < 0 && (errno == EAGAIN ||
+		    errno == EWOULDBLOCK));
+	    break;
+	}
+	client->inUsed += got;
+	char* start = client->in;
+	char* end = client->in + client->inUsed;
+	char* newline;
+	while((newline = memchr(start, '\n', end - start))) {
+	    *newline = '\0';
+	    if(newline > start && newline[-1] == '\r') {
+		newline[-1] = '\0';
+	    }
+	    run_command(server, client, start);
+	    start = newline + 1;
+	}
+	client->inUsed = end - start;
+	memmove(client->in, start, client->inUsed);
+    }
+    flush_client(server, client);
+}
+
+//Accept every waiting connection and add it to the event loop
+void accept_clients(Server* server) {
+    int fd;
+    while((fd = accept(server->listener, NULL, NULL)) >= 0) {
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	Client* client = calloc(1, sizeof(Client));
+	client->fd = fd;
+	client->in = malloc(MAX_LINE + READ_SIZE);
+	struct epoll_event event = {EPOLLIN, {.ptr = client}};
+	epoll_ctl(server->poll, EPOLL_CTL_ADD, fd, &event);
+    }
+}
+
+//Close a client and free it
+void close_client(Server* server, Client* client) {
+    epoll_ctl(server->poll, EPOLL_CTL_DEL, client->fd, NULL);
+    close(client->fd);
+    free(client->in);
+    free(client->out);
+    free(client);
+}
+
+//Listen on the Unix domain socket at the given path. A socket left there
+//by an earlier server is replaced, but nothing else is. Return -1 on
+//failure.
+int listen_socket(const char* path) {
+    struct sockaddr_un address = {AF_UNIX, {0}};
+    struct stat info;
+    if(strlen(path) >= sizeof(address.sun_path)) {
+	return -1;
+    }
+    strcpy(address.sun_path, path);
+    if(stat(path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+	unlink(path);
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if(fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) ||
+	    listen(fd, SOMAXCONN)) {
+	if(fd >= 0) {
+	    close(fd);
+	}
+	return -1;
+    }
+    return fd;
+}
+
+//Host games for clients of a Unix domain socket until killed.
+//  push2310 -S socket [-l millis] [-m megabytes] [-p playouts] [-D depth]
+//	    [-j threads] [-B tablebase]
+//The options are those of the search players, which every game shares.
+int run_server(int argc, char** argv) {
+    Server server = {0};
+    server.settings = (Settings){DEFAULT_MILLIS, DEFAULT_MEGABYTES, 0, 1, 0,
+	    NULL};
+    if(argc < 3) {
+	exit_status(SERVERARGS);
+    }
+    for(int i = 3; i < argc;) {
+	int used = read_setting(&server.settings, argc, argv, i, SERVERARGS);
+	if(!used) {
+	    exit_status(SERVERARGS);
+	}
+	i += used;
+    }
+    if(server.settings.tablebase && !(server.tablebase =
+	    open_tablebase(server.settings.tablebase))) {
+	exit_status(BADTABLE);
+    }
+    server.listener = listen_socket(argv[2]);
+    server.poll = epoll_create1(0);
+    if(server.listener < 0 || server.poll < 0) {
+	exit_status(BADSOCKET);
+    }
+    server.bucketCount = 64;
+    server.buckets = calloc(server.bucketCount, sizeof(Hosted*));
+    struct epoll_event event = {EPOLLIN, {.ptr = NULL}};
+    epoll_ctl(server.poll, EPOLL_CTL_ADD, server.listener, &event);
+    struct epoll_event events[MAX_EVENTS];
+    while(1) {
+	int ready = epoll_wait(server.poll, events, MAX_EVENTS, -1);
+	for(int i = 0; i < ready; i++) {
+	    Client* client = events[i].data.ptr;
+	    if(client == NULL) {
+		accept_clients(&server);
+		continue;
+	    }
+	    if(events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+		read_client(&server, client);
+	    } else if(events[i].events & EPOLLOUT) {
+		flush_client(&server, client);
+	    }
+	    if(client->closed) {
+		close_client(&server, client);
+	    }
+	}
+    }
+}
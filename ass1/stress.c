@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "push2310.h"
+
+//A stress run: random games on random boards of one shape, with every
+//move checked against the invariants unless checking is off. before and
+//rebuilt are scratch boards for the checks.
+typedef struct Stress {
+    Shape shape;
+    uint64_t seed;
+    long games;
+    int check;
+    Game* before;
+    Game* rebuilt;
+    int* moves;
+    long moveCount;
+} Stress;
+
+//Return 1 if two boards hold the same planes, counts, values, scores and
+//hash
+int same_board(Game* a, Game* b) {
+    return a->xScore == b->xScore && a->oScore == b->oScore &&
+	    a->emptyInterior == b->emptyInterior && a->hash == b->hash &&
+	    !memcmp(a->xBits, b->xBits, board_bytes(a));
+}
+
+//Build a board with the same pieces and values from nothing, one piece at
+//a time, so every plane, count, score and the hash are worked out afresh
+void rebuild_board(Game* rebuilt, Game* game) {
+    free(rebuilt->xBits);
+    rebuilt->height = game->height;
+    rebuilt->width = game->width;
+    create_board(rebuilt);
+    memcpy(rebuilt->values, game->values, game->cells);
+    for(int i = 0; i < game->cells; i++) {
+	if(!is_corner(game, i / game->width, i % game->width)) {
+	    put_piece(rebuilt, i, '.');
+	}
+    }
+    for(int i = 0; i < game->cells; i++) {
+	char piece = piece_at(game, i);
+	if(piece == 'X' || piece == 'O') {
+	    put_piece(rebuilt, i, piece);
+	}
+    }
+}
+
+//Return the number of cells holding the given piece
+int count_pieces(Game* game, char piece) {
+    uint64_t* bits = (piece == 'X') ? game->xBits : game->oBits;
+    int count = 0;
+    for(int w = 0; w < game->words; w++) {
+	count += __builtin_popcountll(bits[w]);
+    }
+    return count;
+}
+
+//Check the board after the mover's move against the board before it.
+//Return what is wrong, or NULL if nothing is.
+const char* check_move(Stress* stress, Game* game, Undo undo, char mover) {
+    Game* before = stress->before;
+    char other = (mover == 'X') ? 'O' : 'X';
+    if(count_pieces(game, mover) != count_pieces(before, mover) + 1 ||
+	    count_pieces(game, other) != count_pieces(before, other)) {
+	return "piece count not conserved";
+    }
+    for(int i = 0; i < game->cells; i++) {
+	int row = i / game->width;
+	int col = i % game->width;
+	char piece = piece_at(game, i);
+	if(is_corner(game, row, col) && piece != ' ') {
+	    return "piece in a corner";
+	}
+	if(!is_corner(game, row, col) && piece == ' ') {
+	    return "cell lost";
+	}
+	if(!get_bit(game->interior, i) && piece != '.' &&
+		piece_at(before, i) == '.' &&
+		!(undo.step != 0 && i == undo.to)) {
+	    return "edge cell filled without a push";
+	}
+	int legal = piece == '.' && can_place(game, row, col) &&
+		can_push(game, row, col);
+	if(legal != legal_move(game, row, col)) {
+	    return "legal moves out of step";
+	}
+    }
+    rebuild_board(stress->rebuilt, game);
+    if(!same_board(game, stress->rebuilt)) {
+	return "board state out of step with its pieces";
+    }
+    copy_board(stress->rebuilt, game);	//to put the move back after undo
+    undo_push(game, undo);
+    int undone = same_board(game, before);
+    copy_board(game, stress->rebuilt);
+    if(!undone) {
+	return "undo did not restore the board";
+    }
+    return NULL;
+}
+
+//Play one random game to the end, checking every move if checking is on.
+//Return what went wrong, or NULL if nothing did.
+const char* stress_game(Stress* stress, Game* game, uint64_t* state,
+	int* moveNumber) {
+    while(end_game(game)) {
+	int count = legal_moves(game, stress->moves);
+	int cell = stress->moves[next_random(state) % count];
+	char mover = game->players[game->turn];
+	if(stress->check) {
+	    copy_board(stress->before, game);
+	}
+	Undo undo = check_push(game, cell / game->width, cell % game->width);
+	stress->moveCount++;
+	(*moveNumber)++;
+	if(stress->check) {
+	    const char* failure = check_move(stress, game, undo, mover);
+	    if(failure) {
+		return failure;
+	    }
+	}
+	update_turn(game);
+    }
+    return NULL;
+}
+
+//Read a whole number argument in a range. Exit with the stress usage
+//message if it is not valid.
+long stress_number(char* arg, long low, long high) {
+    char* err;
+    long number = strtol(arg, &err, 10);
+    if(*arg == '\0' || *err != '\0' || number < low || number > high) {
+	exit_status(STRESSARGS);
+    }
+    return number;
+}
+
+//Play random legal games on random boards, checking after every move that
+//pieces are conserved, corners stay empty, edge cells only fill by being
+//pushed into, the board state matches one rebuilt from its pieces and
+//undo restores it. Print how fast the moves were played.
+//  push2310 -Z seed games height width [-v low high] [-f fill] [-u]
+//Values are drawn from low to high (0 to 9 by default) and fill percent
+//of the interior starts with pieces. -u turns the checks off to time the
+//engine alone.
+int run_stress(int argc, char** argv) {
+    Stress stress = {{0, 0, 0, 9, 0}, 0, 0, 1};
+    if(argc < 6) {
+	exit_status(STRESSARGS);
+    }
+    stress.seed = strtoull(argv[2], NULL, 10);
+    stress.games = stress_number(argv[3], 1, LONG_MAX);
+    stress.shape.height = stress_number(argv[4], 3, 1 << 14);
+    stress.shape.width = stress_number(argv[5], 3, 1 << 14);
+    for(int i = 6; i < argc; i++) {
+	if(!strcmp(argv[i], "-v") && i + 2 < argc) {
+	    stress.shape.low = stress_number(argv[i + 1], 0, 9);
+	    stress.shape.high = stress_number(argv[i + 2], stress.shape.low,
+		    9);
+	    i += 2;
+	} else if(!strcmp(argv[i], "-f") && i + 1 < argc) {
+	    stress.shape.fill = stress_number(argv[++i], 0, 100);
+	} else if(!strcmp(argv[i], "-u")) {
+	    stress.check = 0;
+	} else {
+	    exit_status(STRESSARGS);
+	}
+    }
+    Game* game = calloc(1, sizeof(Game));
+    stress.before = calloc(1, sizeof(Game));
+    stress.rebuilt = calloc(1, sizeof(Game));
+    stress.moves = malloc(sizeof(int) *
+	    stress.shape.height * stress.shape.width);
+    double start = now();
+    for(long g = 0; g < stress.games; g++) {
+	uint64_t state = stress.seed + g;
+	state = next_random(&state);
+	generate_board(game, &stress.shape, &state);
+	init_turn(game);
+	int moveNumber = 0;
+	const char* failure = stress_game(&stress, game, &state,
+		&moveNumber);
+	if(failure) {
+	    fprintf(stderr, "Game %ld move %d: %s\n", g, moveNumber,
+		    failure);
+	    exit_status(BADSTRESS);
+	}
+    }
+    double seconds = now() - start;
+    printf("Stress: %ld games, %ld moves, %.3fs, %.0f moves/s%s\n",
+	    stress.games, stress.moveCount, seconds,
+	    seconds > 0 ? stress.moveCount / seconds : 0.0,
+	    stress.check ? "" : " (unchecked)");
+    free(stress.moves);
+    free(stress.rebuilt->xBits);
+    free(stress.rebuilt);
+    free(stress.before->xBits);
+    free(stress.before);
+    free(game->xBits);
+    free(game);
+    return OK;
+}
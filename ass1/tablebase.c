@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "push2310.h"
+
+#define TABLE_VERSION 1
+#define TURN_KEY 0x5A17ULL
+#define BOOK_DEPTH 6
+
+//A solved position. key is 0 in an empty slot. best is the cell of the
+//move to play and value what it is worth to the player to move: the final
+//score difference for a solved position, or the search value for an
+//opening book move.
+typedef struct TableEntry {
+    uint64_t key;
+    int32_t value;
+    int32_t best;
+} TableEntry;
+
+//The tablebase file is a header then an open addressed hash table of
+//entries, in the byte order of the machine that wrote it:
+//  bytes 0-3	magic "P23T"
+//  bytes 4-7	version
+//  bytes 8-15	number of slots, a power of two
+//A position is looked for from slot key & (slots - 1) onwards until it or
+//an empty slot is found.
+typedef struct TableHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t slots;
+} TableHeader;
+
+//A tablebase mapped into memory. It is only read, so any number of games
+//and threads can share one.
+struct Tablebase {
+    void* map;
+    size_t size;
+    uint64_t mask;
+    TableEntry* entries;
+};
+
+//The positions of one board solved while building a tablebase. The table
+//is sized from the memory budget and the solver gives up on the board once
+//it is half full. moves holds the move list of each ply.
+typedef struct Solver {
+    TableEntry* entries;
+    uint64_t mask;
+    uint64_t count;
+    int full;
+    int** moves;
+} Solver;
+
+//Every position to go in the tablebase file
+typedef struct Found {
+    TableEntry* entries;
+    uint64_t count;
+    uint64_t size;
+} Found;
+
+//Return the key of the board's cell values and size. Values never change
+//during a game so it is worked out once and kept on the game.
+uint64_t layout_key(Game* game) {
+    if(game->layout) {
+	return game->layout;
+    }
+    uint64_t state = (uint64_t)game->height << 32 | game->width;
+    uint64_t key = next_random(&state);
+    for(int i = 0; i < game->cells; i++) {
+	key = (key ^ game->values[i]) * 0x100000001B3ULL;
+    }
+    game->layout = key ? key : 1;
+    return game->layout;
+}
+
+//Return the tablebase key of the position: the pieces, the cell values
+//and whose turn it is. It is never 0.
+uint64_t table_key(Game* game) {
+    uint64_t key = game->hash ^ layout_key(game) ^
+	    (game->turn ? TURN_KEY : 0);
+    return key ? key : 1;
+}
+
+//Return the slot of a table holding the key, or the empty slot where it
+//would go
+TableEntry* find_slot(TableEntry* entries, uint64_t mask, uint64_t key) {
+    uint64_t i = key & mask;
+    while(entries[i].key && entries[i].key != key) {
+	i = (i + 1) & mask;
+    }
+    return &entries[i];
+}
+
+//Map a tablebase file into memory. Return NULL if it can't be read or is
+//not a tablebase.
+Tablebase* open_tablebase(const char* fileName) {
+    struct stat info;
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0) {
+	return NULL;
+    }
+    void* map = MAP_FAILED;
+    if(fstat(fd, &info) == 0 && info.st_size >= sizeof(TableHeader)) {
+	map = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if(map == MAP_FAILED) {
+	return NULL;
+    }
+    TableHeader* header = map;
+    uint64_t slots = header->slots;
+    if(memcmp(header->magic, "P23T", 4) || header->version != TABLE_VERSION ||
+	    slots == 0 || (slots & (slots - 1)) ||
+	    info.st_size != sizeof(TableHeader) + slots * sizeof(TableEntry)) {
+	munmap(map, info.st_size);
+	return NULL;
+    }
+    Tablebase* table = malloc(sizeof(Tablebase));
+    table->map = map;
+    table->size = info.st_size;
+    table->mask = slots - 1;
+    table->entries = (TableEntry*)(header + 1);
+    return table;
+}
+
+//Unmap a tablebase
+void close_tablebase(Tablebase* table) {
+    munmap(table->map, table->size);
+    free(table);
+}
+
+//Look the game's position up in the tablebase. Return 1 and set the move
+//to play if it is there. The table is read from a file and its key is a
+//hash, so a move that is not legal here is not played.
+int tablebase_move(Tablebase* table, Game* game, Move* move) {
+    TableEntry* entry = find_slot(table->entries, table->mask,
+	    table_key(game));
+    if(!entry->key || entry->best < 0 || entry->best >= game->cells) {
+	return 0;
+    }
+    *move = cell_move(game, entry->best);
+    return legal_move(game, move->row, move->col);
+}
+
+//Add a position to the solver's table. Once the table is as full as it
+//should get the solver gives up.
+void add_solved(Solver* solver, uint64_t key, int value, int best) {
+    if(solver->count >= (solver->mask + 1) / 2) {
+	solver->full = 1;
+	return;
+    }
+    TableEntry* entry = find_slot(solver->entries, solver->mask, key);
+    if(!entry->key) {
+	solver->count++;
+    }
+    entry->key = key;
+    entry->value = value;
+    entry->best = best;
+}
+
+//Add a position to those going in the tablebase file
+void add_found(Found* found, TableEntry entry) {
+    if(found->count == found->size) {
+	found->size = found->size ? found->size * 2 : 1024;
+	found->entries = realloc(found->entries,
+		sizeof(TableEntry) * found->size);
+    }
+    found->entries[found->count++] = entry;
+}
+
+//Work out the value of the position with both players playing perfectly,
+//adding every position solved on the way to the table. Every move fills
+//a vacant cell so no game is longer than the vacant cells at the start.
+int solve(Solver* solver, Game* game, int ply) {
+    if(!end_game(game)) {
+	return evaluate(game);
+    }
+    uint64_t key = table_key(game);
+    TableEntry* entry = find_slot(solver->entries, solver->mask, key);
+    if(entry->key) {
+	return entry->value;
+    }
+    int* list = solver->moves[ply];
+    int count = legal_moves(game, list);
+    int bestValue = INT_MIN;
+    int best = list[0];
+    for(int i = 0; i < count && !solver->full; i++) {
+	Undo undo = make_move(game, list[i]);
+	int value = -solve(solver, game, ply + 1);
+	unmake_move(game, undo);
+	if(value > bestValue) {
+	    bestValue = value;
+	    best = list[i];
+	}
+    }
+    if(!solver->full) {
+	add_solved(solver, key, bestValue, best);
+    }
+    return bestValue;
+}
+
+//Try to solve a board exhaustively with the solver's table. Return 0 if
+//the table ran out of room first.
+int solve_board(Solver* solver, Game* game) {
+    int vacant = 0;
+    for(int w = 0; w < game->words; w++) {
+	vacant += __builtin_popcountll(game->emptyBits[w]);
+    }
+    memset(solver->entries, 0, sizeof(TableEntry) * (solver->mask + 1));
+    solver->count = 0;
+    solver->full = 0;
+    solver->moves = malloc(sizeof(int*) * (vacant + 1));
+    for(int i = 0; i <= vacant; i++) {
+	solver->moves[i] = malloc(sizeof(int) * game->cells);
+    }
+    solve(solver, game, 0);
+    for(int i = 0; i <= vacant; i++) {
+	free(solver->moves[i]);
+    }
+    free(solver->moves);
+    return !solver->full;
+}
+
+//Return the opening book entry for the board: the move a fixed depth
+//search finds from its start
+TableEntry book_move(Game* game, Settings* settings) {
+    Settings book = *settings;
+    if(!book.depth) {
+	book.depth = BOOK_DEPTH;
+    }
+    game->search = create_search(&book);
+    new_search_game(game->search);
+    Move move = search_move(game);
+    free_search(game->search);
+    game->search = NULL;
+    return (TableEntry){table_key(game), 0,
+	    move.row * game->width + move.col};
+}
+
+//Write the positions found to a tablebase file with one write. The file
+//table has at least twice as many slots as positions so lookups stay
+//short. Return 0 if the file can't be written.
+int write_tablebase(Found* found, const char* fileName) {
+    uint64_t slots = 1;
+    while(slots < found->count * 2) {
+	slots *= 2;
+    }
+    size_t size = sizeof(TableHeader) + slots * sizeof(TableEntry);
+    TableHeader* header = calloc(size, 1);
+    TableEntry* entries = (TableEntry*)(header + 1);
+    memcpy(header->magic, "P23T", 4);
+    header->version = TABLE_VERSION;
+    header->slots = slots;
+    for(uint64_t i = 0; i < found->count; i++) {
+	*find_slot(entries, slots - 1, found->entries[i].key) =
+		found->entries[i];
+    }
+    FILE* file = fopen(fileName, "w");
+    int written = 0;
+    if(file != NULL) {
+	written = fwrite(header, size, 1, file) == 1;
+	written &= fclose(file) == 0;
+    }
+    free(header);
+    return written;
+}
+
+//Build a tablebase from save files. Boards of up to 5x5 interior cells
+//are solved exhaustively within the memory budget; the rest, and any
+//that don't fit, get an opening book move from a search of their start
+//to the given depth.
+//  push2310 -T outfile [-m megabytes] [-D depth] [-j threads] fname...
+int run_tablebase(int argc, char** argv) {
+    Settings settings = {DEFAULT_MILLIS, DEFAULT_MEGABYTES, 0, 1, 0, NULL};
+    int source = 3;
+    if(argc < 4) {
+	exit_status(TABLEARGS);
+    }
+    int used;
+    while(source < argc && (used = read_setting(&settings, argc, argv,
+	    source, TABLEARGS))) {
+	source += used;
+    }
+    if(source >= argc) {
+	exit_status(TABLEARGS);
+    }
+    Solver solver = {0};
+    Found found = {0};
+    solver.mask = 1;
+    while((solver.mask + 1) * 2 * sizeof(TableEntry) <=
+	    (uint64_t)settings.tableMegabytes << 20) {
+	solver.mask = solver.mask * 2 + 1;
+    }
+    solver.entries = malloc(sizeof(TableEntry) * (solver.mask + 1));
+    Game* game = calloc(1, sizeof(Game));
+    for(int i = source; i < argc; i++) {
+	game->file = argv[i];
+	Status status = read_file(game);
+	if(status == OK) {
+	    status = is_board_full(game);
+	}
+	if(status != OK) {
+	    fprintf(stderr, "%s: %s", argv[i], status_message(status));
+	    continue;
+	}
+	init_turn(game);
+	if(game->height <= 7 && game->width <= 7 &&
+		solve_board(&solver, game)) {
+	    for(uint64_t j = 0; j <= solver.mask; j++) {
+		if(solver.entries[j].key) {
+		    add_found(&found, solver.entries[j]);
+		}
+	    }
+	    printf("%s: solved, %lu positions\n", argv[i],
+		    (unsigned long)solver.count);
+	} else {
+	    add_found(&found, book_move(game, &settings));
+	    printf("%s: book move\n", argv[i]);
+	}
+	free(game->xBits);
+	game->xBits = NULL;
+    }
+    if(!write_tablebase(&found, argv[2])) {
+	exit_status(BADTABLE);
+    }
+    printf("Tablebase: %lu positions\n", (unsigned long)found.count);
+    free(found.entries);
+    free(solver.entries);
+    free(game);
+    return OK;
+}
@@ -8,6 +8,19 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <poll.h>
+#include <dlfcn.h>
+#include <signal.h>
+#include <sys/prctl.h>
+#include "player.h"
+#include "ring.h"
+
+#define TURN_MILLIS 5000
+#define LINE_SIZE 256
+#define RING_CHECK_MILLIS 50
 
 typedef enum {
     NORMAL = 0,
@@ -15,7 +28,8 @@ typedef enum {
     INVALID_DECK = 2,
     INVALID_PATH = 3,
     BAD_PLAYER = 4,
-    COMM_ERROR = 5
+    COMM_ERROR = 5,
+    TOURNAMENT_ARGS = 6
 } Status;
 
 //exits the program with specified exit and message
@@ -25,17 +39,32 @@ Status exit_status(Status s) {
 	    "Error reading deck\n",
 	    "Error reading path\n",
 	    "Error starting process\n",
-	    "Communications error\n"};
+	    "Communications error\n",
+	    "Usage: 2310dealer -t games jobs seats [-w] [-s] -d deck... "
+	    "-p path... -r player...\n"};
     fputs(messages[s], stderr);
     exit(s);
 }
 
+//A player strategy loaded from a shared object, see player.h
+typedef struct Plugin {
+    PathCallback on_path;
+    HapCallback on_hap;
+    TurnCallback on_your_turn;
+    DoneCallback on_done;
+} Plugin;
+
 typedef struct Player {
+    Plugin* plugin;
+    void* state;
+    Channel* channel;
     FILE* pc;
-    FILE* cp;
     pid_t pid;
     int ptoc[2];
     int ctop[2];
+    char line[LINE_SIZE];
+    int used;
+    int closed;
     char* name;
     char id;
     char lastItem;
@@ -63,6 +92,11 @@ typedef struct Game {
     int pathsDigits;
     int currentItem;
     int* scoreList;
+    int resultFd;
+    int keepPlayers;
+    int epoll;
+    Broadcast* broadcast;
+    int broadcastFd;
     Player** playerList;
 } Game;
 
@@ -71,13 +105,14 @@ void init_player_process(Game* game, char** argv);
 void print_board(Game* game);
 void send_your_turn(Game* game, int id);
 void check_item_length(Game* game, char text[]);
+long now_millis(void);
 
 //Create the game board. The board will be created sing the path
 //file. The population or '-' char of each site or barrier will be
 //replaced with ' '. Players will start on the board represented by their
 //id's ion decending order.
 void create_board(Game* game) {
-    game->board = malloc(sizeof(char*) * game->players + 1);
+    game->board = malloc(sizeof(char*) * (game->players + 1));
     int k = 1; //counter for ' ' replacement on every 3rd char
     for(int i = 0; i < game->players + 1; i++) {
 	game->board[i] = malloc(sizeof(char) * (game->paths * 3));
@@ -138,61 +173,193 @@ void create_path_deck(Game* game) {
 //Allocate the raw path deck to send to players
 void create_raw_path_deck(Game* game) {
     game->rawPathDeck = malloc(sizeof(char) * 
-	    (game->paths * 3) + game->pathsDigits);
+	    (game->paths * 3) + game->pathsDigits + 1);
+}
+
+//Set the player's money, points, sites and items to their values at the
+//start of a game
+void reset_player(Player* player) {
+    player->money = 7;
+    player->points = 0;
+    player->v1 = 0;
+    player->v2 = 0;
+    player->a = 0;
+    player->b = 0;
+    player->c = 0;
+    player->d = 0;
+    player->e = 0;
+}
+
+//Load a player plugin from a shared object. Return NULL if it can't be
+//loaded or is missing a callback.
+Plugin* load_plugin(char* name) {
+    void* library = dlopen(name, RTLD_NOW | RTLD_LOCAL);
+    if(library == NULL) {
+	return NULL;
+    }
+    Plugin* plugin = malloc(sizeof(Plugin));
+    *(void**)&plugin->on_path = dlsym(library, "on_path");
+    *(void**)&plugin->on_hap = dlsym(library, "on_hap");
+    *(void**)&plugin->on_your_turn = dlsym(library, "on_your_turn");
+    *(void**)&plugin->on_done = dlsym(library, "on_done");
+    if(!plugin->on_path || !plugin->on_hap || !plugin->on_your_turn ||
+	    !plugin->on_done) {
+	free(plugin);
+	return NULL;
+    }
+    return plugin;
+}
+
+//Return 1 if the player is a shared object to be played in this process
+int is_plugin(char* name) {
+    int length = strlen(name);
+    return length > 3 && !strcmp(name + length - 3, ".so");
+}
+
+//Create a player in the given seat. A player named by a shared object is
+//loaded as a plugin; any other is a program started later.
+Player* create_player(char* name, int seat) {
+    Player* player = malloc(sizeof(Player));
+    player->name = name;
+    player->id = seat + '0';  //convert to char
+    player->used = 0;
+    player->closed = 0;
+    player->state = NULL;
+    player->channel = NULL;
+    reset_player(player);
+    player->plugin = NULL;
+    if(is_plugin(name)) {
+	player->plugin = load_plugin(name);
+	if(player->plugin == NULL) {
+	    exit_status(BAD_PLAYER);
+	}
+    }
+    return player;
 }
 
-//Initialise all the player variables
-void init_players(Game* game, char** argv, int argc) {
+//Initialise all the player variables. names holds the program of each
+//player in turn.
+void init_players(Game* game, char** names) {
     game->playerList = malloc(sizeof(struct Player*) * game->players);
     for(int i = 0; i < game->players; i++) {
-	game->playerList[i] = malloc(sizeof(Player)); //setup player list
-	game->playerList[i]->name = argv[i + 3];
-	game->playerList[i]->id = i + '0';  //convert to char
-	game->playerList[i]->money = 7;
-	game->playerList[i]->points = 0;
-	game->playerList[i]->v1 = 0;
-	game->playerList[i]->v2 = 0;
-	game->playerList[i]->a = 0;
-	game->playerList[i]->b = 0;
-	game->playerList[i]->c = 0;
-	game->playerList[i]->d = 0;
-	game->playerList[i]->e = 0;
-	pipe(game->playerList[i]->ptoc);
-	pipe(game->playerList[i]->ctop);
+	game->playerList[i] = create_player(names[i], i);
     }
 }
 
-//Forks the player processes and initalise them using execvp
-void init_player_process(Game* game, char** argv) {
-    int file;
+//Watch the read end of the player's pipe with the game's epoll
+void watch_player(Game* game, int i) {
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.u32 = i;
+    fcntl(game->playerList[i]->ctop[0], F_SETFL, O_NONBLOCK);
+    if(epoll_ctl(game->epoll, EPOLL_CTL_ADD, game->playerList[i]->ctop[0],
+	    &event) < 0) {
+	exit_status(BAD_PLAYER);
+    }
+}
+
+//Watch every player of the game with a new epoll
+void watch_players(Game* game) {
+    game->epoll = epoll_create1(EPOLL_CLOEXEC);
+    if(game->epoll < 0) {
+	exit_status(BAD_PLAYER);
+    }
     for(int i = 0; i < game->players; i++) {
-	game->playerList[i]->pid = fork();
-	if(game->playerList[i]->pid < 0) {
+	if(!game->playerList[i]->plugin && !game->playerList[i]->channel) {
+	    watch_player(game, i);
+	}
+    }
+}
+
+//Create the broadcast ring of the game, which makes every player process
+//started for it a ring player
+void start_broadcast(Game* game) {
+    game->broadcast = create_shared(sizeof(Broadcast), &game->broadcastFd);
+    if(game->broadcast == NULL) {
+	exit_status(BAD_PLAYER);
+    }
+}
+
+//Create the pipes to talk to a player. Only the player's own ends of them
+//survive its execvp.
+void create_pipes(Player* player) {
+    pipe(player->ptoc);
+    pipe(player->ctop);
+    for(int j = 0; j < 2; j++) {	//so no player holds another's pipes
+	fcntl(player->ptoc[j], F_SETFD, FD_CLOEXEC);
+	fcntl(player->ctop[j], F_SETFD, FD_CLOEXEC);
+    }
+}
+
+//Set up a ring player's side before execvp: its channel and the broadcast
+//ring are passed on in PLAYER_RING, and it is ended if the dealer exits as
+//it has no pipe to see closed.
+void pass_rings(Game* game, int channelFd) {
+    char rings[32];
+    int file = open("/dev/null", O_RDWR);
+    dup2(file, STDIN_FILENO);
+    dup2(file, STDOUT_FILENO);
+    fcntl(channelFd, F_SETFD, 0);
+    fcntl(game->broadcastFd, F_SETFD, 0);
+    sprintf(rings, "%d,%d", channelFd, game->broadcastFd);
+    setenv("PLAYER_RING", rings, 1);
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+}
+
+//Fork a player process for the game and start it using execvp. It talks
+//to the dealer over pipes, or over a channel of rings if the game has a
+//broadcast ring.
+void start_player_process(Game* game, Player* player) {
+    int file;
+    int channelFd = -1;
+    if(player->plugin) {
+	return;
+    }
+    if(game->broadcast) {
+	player->channel = create_shared(sizeof(Channel), &channelFd);
+	if(player->channel == NULL) {
 	    exit_status(BAD_PLAYER);
 	}
-	if(game->playerList[i]->pid == 0) {	//We are in child
-	    close(game->playerList[i]->ptoc[1]);
-	    close(game->playerList[i]->ctop[0]);
-	    file = open("/dev/null", O_WRONLY); //remove for testing
-            dup2(game->playerList[i]->ptoc[0], STDIN_FILENO);
-            dup2(game->playerList[i]->ctop[1], STDOUT_FILENO);
-	    dup2(file, STDERR_FILENO);		//remove for testing
-	    char* players = malloc(sizeof(char) * 2);
-	    sprintf(players, "%d", game->players);
-	    char* id = malloc(sizeof(char) * 2);
-	    sprintf(id, "%c", game->playerList[i]->id);
-	    char* args[] = {game->playerList[i]->name, players, id, NULL};
-            execvp(args[0], args);
-            exit(BAD_PLAYER);
-	} else { //we are the parent
-	    close(game->playerList[i]->ptoc[0]); //close other end of pipe
-            close(game->playerList[i]->ctop[1]); //close other end of pipe
-	    game->playerList[i]->pc = 
-		    fdopen(game->playerList[i]->ptoc[1], "w");
-            game->playerList[i]->cp = 
-		    fdopen(game->playerList[i]->ctop[0], "r");
+    } else {
+	create_pipes(player);
+    }
+    player->pid = fork();
+    if(player->pid < 0) {
+	exit_status(BAD_PLAYER);
+    }
+    if(player->pid == 0) {	//We are in child
+	if(player->channel) {
+	    pass_rings(game, channelFd);
+	} else {
+	    close(player->ptoc[1]);
+	    close(player->ctop[0]);
+	    dup2(player->ptoc[0], STDIN_FILENO);
+	    dup2(player->ctop[1], STDOUT_FILENO);
 	}
+	file = open("/dev/null", O_WRONLY); //remove for testing
+	dup2(file, STDERR_FILENO);		//remove for testing
+	char* count = malloc(sizeof(char) * 2);
+	sprintf(count, "%d", game->players);
+	char* id = malloc(sizeof(char) * 2);
+	sprintf(id, "%c", player->id);
+	char* args[] = {player->name, count, id, NULL};
+	execvp(args[0], args);
+	exit(BAD_PLAYER);
+    } else if(player->channel) {
+	close(channelFd);
+    } else { //we are the parent
+	close(player->ptoc[0]); //close other end of pipe
+	close(player->ctop[1]); //close other end of pipe
+	player->pc = fdopen(player->ptoc[1], "w");
+    }
+}
+
+//Forks the player processes and initalise them using execvp
+void init_player_process(Game* game, char** argv) {
+    for(int i = 0; i < game->players; i++) {
+	start_player_process(game, game->playerList[i]);
     }
+    watch_players(game);
 }
 
 //Check validity of the item file.
@@ -217,14 +384,20 @@ void read_item_file(Game* game) {
     if(f == NULL) {
 	exit_status(INVALID_DECK);
     }
-    fgets(itemText, 256, f);
+    if(!fgets(itemText, 256, f)) {
+	exit_status(INVALID_DECK);
+    }
+    fclose(f);
     check_item_length(game, itemText);
     int tempItem = game->items;
-    game->itemDeck = malloc(sizeof(char) * game->items);
+    game->itemDeck = malloc(sizeof(char) * game->items + 1);
     do {
 	count++;
 	tempItem /= 10;
     } while(tempItem != 0);
+    if(game->items < 1 || strlen(itemText) < count + game->items) {
+	exit_status(INVALID_DECK);
+    }
     for(int i = 0; i < game->items + 1; i++) {
 	game->itemDeck[i] = itemText[i + count];
     }
@@ -279,13 +452,11 @@ void check_site(char* site) {
 //Check the length of the item list and store it
 void check_item_length(Game* game, char text[]) {
     int items = 0;
-    for(int i = 0; i < 256; i++) {
-	if(isdigit(text[i])) {
-	    items = i;
-	}
+    while(isdigit(text[items])) {
+	items++;
     }
     char* err1;
-    char itemCopy[items];
+    char itemCopy[items + 1];
     strncpy(itemCopy, text, items);
     itemCopy[items] = '\0';
     game->items = strtoul(itemCopy, &err1, 10);
@@ -328,6 +499,7 @@ void read_path_file(Game* game) {
     for(int i = 0; i < game->pathsDigits + (game->paths * 3); i++) {
 	game->rawPathDeck[i] = text[i];
     }
+    game->rawPathDeck[game->pathsDigits + (game->paths * 3)] = '\0';
     for(int i = 0; i < game->paths * 3; i++) {
 	game->pathDeck[i] = text[i + game->pathsDigits];
     }
@@ -346,11 +518,53 @@ int end_game(Game* game) {
     return endGame;
 }
 
-//Send the raw path deck to the players.
+//Send a message to a player process down its pipe, or down its channel if
+//it is a ring player. A channel too full to take it is a communications
+//error.
+void send_message(Game* game, Player* player, const char* text) {
+    if(player->channel) {
+	if(!channel_send(player->channel, game->broadcast, text)) {
+	    exit_status(COMM_ERROR);
+	}
+	return;
+    }
+    fputs(text, player->pc);
+    fflush(player->pc);
+}
+
+//Write a message once to the broadcast ring for the given ring players.
+//Wait for the slowest of them to make room for it, up to a turn.
+void send_broadcast(Game* game, Channel** readers, int count,
+	const char* text) {
+    long deadline = now_millis() + TURN_MILLIS;
+    while(!broadcast_send(game->broadcast, readers, count, text)) {
+	if(now_millis() > deadline) {
+	    exit_status(COMM_ERROR);
+	}
+	usleep(1000);
+    }
+}
+
+//Send the raw path deck to the players. A plugin that rejects it is a
+//communications error, as a process would exit on it. A ring player
+//starts reading the broadcast ring from here.
 void send_path_deck(Game* game) {
+    char text[strlen(game->rawPathDeck) + 2];
+    sprintf(text, "%s\n", game->rawPathDeck);
     for(int i = 0; i < game->players; i++) {
-	fprintf(game->playerList[i]->pc, "%s\n", game->rawPathDeck);
-	fflush(game->playerList[i]->pc);
+	Player* player = game->playerList[i];
+	if(player->plugin) {
+	    player->state = player->plugin->on_path(game->players, i,
+		    game->rawPathDeck);
+	    if(player->state == NULL) {
+		exit_status(COMM_ERROR);
+	    }
+	    continue;
+	}
+	if(player->channel) {
+	    player->channel->broadcastHead = game->broadcast->tail;
+	}
+	send_message(game, player, text);
     }
 }
 
@@ -372,16 +586,18 @@ int this_players_turn(Game* game) {
 
 //Send YT message to player
 void send_your_turn(Game* game, int id) {
-    fprintf(game->playerList[id]->pc, "YT\n");
-    fflush(game->playerList[id]->pc);
+    send_message(game, game->playerList[id], "YT\n");
 }
 
 //Send HAP message to players. Player will update their variables
-//based on this message.
+//based on this message. Ring players share one copy of it.
 void send_hap(Game* game, int p, int n) {
     int s = 0;
     int m = 0;
     char c = '0';
+    char text[64];
+    Channel* readers[game->players];
+    int count = 0;
     if(game->board[0][n * 3] == 'M') {
 	m = 3;
     } else if(game->board[0][n * 3] == 'R') {
@@ -390,9 +606,21 @@ void send_hap(Game* game, int p, int n) {
 	s = (game->playerList[p]->money / 2);
 	m = (-1 * game->playerList[p]->money);
     }
+    sprintf(text, "HAP%d,%d,%d,%d,%c\n", p, n, s, m, c);
     for(int i = 0; i < game->players; i++) {
-	fprintf(game->playerList[i]->pc, "HAP%d,%d,%d,%d,%c\n", p, n, s, m, c);
-	fflush(game->playerList[i]->pc);
+	Player* player = game->playerList[i];
+	if(player->plugin) {
+	    if(!player->plugin->on_hap(player->state, p, n, s, m, c - '0')) {
+		exit_status(COMM_ERROR);
+	    }
+	} else if(player->channel) {
+	    readers[count++] = player->channel;
+	} else {
+	    send_message(game, player, text);
+	}
+    }
+    if(count) {
+	send_broadcast(game, readers, count, text);
     }
     if(game->board[0][n * 3] == 'D') {
 	game->playerList[p]->points = 
@@ -525,15 +753,176 @@ int score_items(Game* game, int i) {
     }
 }
 
-//Acknowledge the player. 
+//Return the time in milliseconds from a fixed point
+long now_millis(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000L + now.tv_nsec / 1000000;
+}
+
+//Read whatever the player has sent into its buffer. Once the player
+//closes its end of the pipe it is marked closed and no longer watched.
+void fill_buffer(Game* game, int i) {
+    Player* player = game->playerList[i];
+    while(!player->closed && player->used < LINE_SIZE) {
+	ssize_t got = read(player->ctop[0], player->line + player->used,
+		LINE_SIZE - player->used);
+	if(got > 0) {
+	    player->used += got;
+	} else if(got < 0 && errno == EINTR) {
+	    continue;
+	} else if(got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+	    return;
+	} else {
+	    epoll_ctl(game->epoll, EPOLL_CTL_DEL, player->ctop[0], NULL);
+	    close(player->ctop[0]);
+	    player->closed = 1;
+	}
+    }
+}
+
+//Move whatever the ring players have sent into their buffers. Return 1
+//if there was anything.
+int fill_rings(Game* game) {
+    int got = 0;
+    for(int i = 0; i < game->players; i++) {
+	Player* player = game->playerList[i];
+	if(player->channel) {
+	    int count = channel_receive(player->channel,
+		    player->line + player->used, LINE_SIZE - player->used);
+	    player->used = player->used + count;
+	    got = got || count;
+	}
+    }
+    return got;
+}
+
+//Mark any ring player that has exited as closed, as a pipe would be, and
+//take what it sent before it went. Return 1 if any had exited.
+int reap_rings(Game* game) {
+    int reaped = 0;
+    for(int i = 0; i < game->players; i++) {
+	Player* player = game->playerList[i];
+	if(player->channel && !player->closed &&
+		waitpid(player->pid, NULL, WNOHANG) == player->pid) {
+	    player->closed = 1;
+	    reaped = 1;
+	}
+    }
+    fill_rings(game);
+    return reaped;
+}
+
+//wait_players for ring players. The dealer sleeps on its doorbell, which
+//the players ring when they write. Exits ring nothing, so the players are
+//checked for having exited every RING_CHECK_MILLIS.
+int wait_rings(Game* game, long deadline) {
+    Broadcast* broadcast = game->broadcast;
+    uint32_t seen = read_bell(&broadcast->dealerBell);
+    if(fill_rings(game)) {
+	return 1;
+    }
+    long left = deadline - now_millis();
+    if(left <= 0) {
+	return 0;
+    }
+    wait_bell(&broadcast->dealerBell, &broadcast->dealerSleeping, seen,
+	    left < RING_CHECK_MILLIS ? left : RING_CHECK_MILLIS);
+    if(!fill_rings(game)) {
+	reap_rings(game);
+    }
+    return 1;
+}
+
+//Wait until a player sends something or closes its pipe, and read it
+//into that player's buffer. Return 0 if the deadline passes first.
+int wait_players(Game* game, long deadline) {
+    struct epoll_event events[16];
+    if(game->broadcast) {
+	return wait_rings(game, deadline);
+    }
+    long left = deadline - now_millis();
+    if(left <= 0) {
+	return 0;
+    }
+    int ready = epoll_wait(game->epoll, events, 16, left);
+    if(ready < 0 && errno != EINTR) {
+	exit_status(COMM_ERROR);
+    }
+    for(int i = 0; i < ready; i++) {
+	fill_buffer(game, events[i].data.u32);
+    }
+    return ready != 0;
+}
+
+//Remove the first count bytes from the player's buffer
+void take_bytes(Player* player, int count) {
+    player->used = player->used - count;
+    memmove(player->line, player->line + count, player->used);
+}
+
+//Return the length of the first whole line in the player's buffer,
+//newline included, or 0 if there is no whole line yet
+int line_length(Player* player) {
+    char* end = memchr(player->line, '\n', player->used);
+    return end ? end - player->line + 1 : 0;
+}
+
+//Acknowledge the players. Every player must send '^' before the 
+//deadline, in any order.
 void acknowledge_player(Game* game) {
+    long deadline = now_millis() + TURN_MILLIS;
+    int waiting = game->players;
+    while(waiting) {
+	waiting = 0;
+	for(int i = 0; i < game->players; i++) {
+	    Player* player = game->playerList[i];
+	    if(player->plugin) {
+		continue;
+	    } else if(player->used && player->line[0] != '^') {
+		exit_status(BAD_PLAYER);
+	    } else if(!player->used && player->closed) {
+		exit_status(BAD_PLAYER);
+	    } else if(!player->used) {
+		waiting++;
+	    }
+	}
+	if(waiting && !wait_players(game, deadline)) {
+	    exit_status(COMM_ERROR);
+	}
+    }
     for(int i = 0; i < game->players; i++) {
-	char ack = fgetc(game->playerList[i]->cp);
-	if(ack != '^') {
-	    exit_status(BAD_PLAYER);
+	if(!game->playerList[i]->plugin) {
+	    take_bytes(game->playerList[i], 1);
+	}
+    }
+}
+
+//Wait for a line from the player whose turn it is and copy it into
+//rxMsg without its newline. A whole line from any other player is out of
+//turn, and that, a line too long for the buffer, a player closing its
+//pipe or the turn running past its deadline are communications errors.
+void read_turn(Game* game, int id, char* rxMsg) {
+    long deadline = now_millis() + TURN_MILLIS;
+    Player* player = game->playerList[id];
+    while(1) {
+	int length = line_length(player);
+	if(length) {
+	    memcpy(rxMsg, player->line, length - 1);
+	    rxMsg[length - 1] = '\0';
+	    take_bytes(player, length);
+	    return;
+	}
+	for(int i = 0; i < game->players; i++) {
+	    Player* other = game->playerList[i];
+	    if(other->closed || other->used == LINE_SIZE ||
+		    (i != id && line_length(other))) {
+		exit_status(COMM_ERROR);
+	    }
+	}
+	if(!wait_players(game, deadline)) {
+	    exit_status(COMM_ERROR);
 	}
-	fputc('\n', game->playerList[i]->cp);
-	fflush(game->playerList[i]->cp);
     }
 }
 
@@ -552,41 +941,64 @@ void do_score(Game* game) {
 	fprintf(stdout, ",%d", game->scoreList[i]);
     }
     fprintf(stdout, "\n");
+    if(game->resultFd >= 0) {
+	write(game->resultFd, game->scoreList, sizeof(int) * game->players);
+    }
 }
 
-//Send done message to players 
+//Send done message to players. Players kept for another game are sent
+//NEXT instead, and acknowledge again once they are ready for it.
 void send_done_message(Game* game) {
     for(int i = 0; i < game->players; i++) {
-	fprintf(game->playerList[i]->pc, "DONE");
-	fflush(game->playerList[i]->pc);
+	Player* player = game->playerList[i];
+	if(player->plugin) {
+	    player->plugin->on_done(player->state);
+	    player->state = NULL;
+	    continue;
+	}
+	send_message(game, player, game->keepPlayers ? "NEXT\n" : "DONE");
     }
 }
 
+//Have the player whose turn it is choose a site and return it. A plugin
+//is asked directly; a process is sent YT and must answer with DO. Any
+//other answer, or a site that is not on the path, is a communications
+//error.
+int take_turn(Game* game, int id) {
+    Player* player = game->playerList[id];
+    char rxMsg[LINE_SIZE];
+    int site = -1;
+    if(player->plugin) {
+	site = player->plugin->on_your_turn(player->state);
+    } else {
+	send_your_turn(game, id);
+	read_turn(game, id, rxMsg);
+	if(strncmp("DO", rxMsg, 2) || sscanf(rxMsg, "DO%d", &site) != 1) {
+	    exit_status(COMM_ERROR);
+	}
+    }
+    if(site < 0 || site >= game->paths) {
+	exit_status(COMM_ERROR);
+    }
+    return site;
+}
+
 //Start the game reading messages from players
 void game_loop(Game* game) {
     print_board(game);
-    char rxMsg[16];
-    char* rxScan = &rxMsg[0];
-    int site;
     send_path_deck(game);
     while(1) {
-	send_your_turn(game, this_players_turn(game));
 	int playerId = this_players_turn(game);
-	if(!fgets(rxScan, 16, game->playerList[playerId]->cp)) {
-	    exit(1);
-	}
-	if(!strncmp("DO", rxScan, 2)) {
-	    sscanf(rxMsg, "DO%d", &site);
-	    move_player(game, site * 3, game->playerList[playerId]->id);
-	    update_player_stats(game, playerId, site * 3);
-	    send_hap(game, playerId, site);
-	    print_player_update(game, playerId);
-	    print_board(game);
-	}
+	int site = take_turn(game, playerId);
+	move_player(game, site * 3, game->playerList[playerId]->id);
+	update_player_stats(game, playerId, site * 3);
+	send_hap(game, playerId, site);
+	print_player_update(game, playerId);
+	print_board(game);
 	if(end_game(game)) {
 	    do_score(game);
 	    send_done_message(game);
-	    exit_status(NORMAL);
+	    return;
 	}
     }
 }
@@ -607,16 +1019,462 @@ void validate_arguements(Game* game, int argc, char** argv) {
     game->players = argc - 3;
     game->scoreList = malloc(sizeof(int) * game->players);
     game->currentItem = 0;
+    game->resultFd = -1;
+    game->keepPlayers = 0;
+    game->broadcast = NULL;
     read_files(game);
-    init_players(game, argv, argc);
+    init_players(game, argv + 3);
+    create_board(game);
+}
+
+//How one roster player has done over a tournament
+typedef struct Standing {
+    int games;
+    int wins;
+    long total;
+    int best;
+    int worst;
+} Standing;
+
+//A game of a tournament being played by a forked dealer. The dealer
+//writes the final scores down result.
+typedef struct Running {
+    pid_t pid;
+    int result;
+    int round;
+} Running;
+
+//A dealer kept running for a share of a tournament's games, with its own
+//pool of players. It writes the number and scores of each game down
+//result as the game finishes. next is the game it is playing.
+typedef struct Lane {
+    pid_t pid;
+    int result;
+    int next;
+} Lane;
+
+//A tournament: games played over every pairing of deck and path file,
+//with the seats filled from the roster in turn. Each file is read once,
+//up front.
+typedef struct Tournament {
+    int games;
+    int jobs;
+    int seats;
+    int pool;
+    int shared;
+    int decks;
+    int pathFiles;
+    int rosterSize;
+    Game** deckList;
+    Game** pathList;
+    char** roster;
+    Standing* standings;
+    int failed;
+    Broadcast* broadcast;
+    int broadcastFd;
+} Tournament;
+
+//Read a whole number argument in a range. Exit with the tournament usage
+//message if it is not valid.
+int tournament_number(char* arg, int low, int high) {
+    char* err;
+    long number = strtol(arg, &err, 10);
+    if(*arg == '\0' || *err != '\0' || number < low || number > high) {
+	exit_status(TOURNAMENT_ARGS);
+    }
+    return number;
+}
+
+//Collect the arguments after flag up to the next flag or the end.
+//Return how many there are.
+int tournament_list(int argc, char** argv, int* next, char* flag,
+	char*** list) {
+    if(*next >= argc || strcmp(argv[*next], flag)) {
+	exit_status(TOURNAMENT_ARGS);
+    }
+    int start = ++(*next);
+    while(*next < argc && argv[*next][0] != '-') {
+	(*next)++;
+    }
+    if(*next == start) {
+	exit_status(TOURNAMENT_ARGS);
+    }
+    *list = argv + start;
+    return *next - start;
+}
+
+//Read every deck and path file of the tournament. A bad file ends the
+//tournament the way it would end a single game.
+void read_tournament_files(Tournament* tour, char** decks, char** paths) {
+    tour->deckList = malloc(sizeof(Game*) * tour->decks);
+    for(int i = 0; i < tour->decks; i++) {
+	tour->deckList[i] = malloc(sizeof(Game));
+	tour->deckList[i]->itemFile = decks[i];
+	read_item_file(tour->deckList[i]);
+    }
+    tour->pathList = malloc(sizeof(Game*) * tour->pathFiles);
+    for(int i = 0; i < tour->pathFiles; i++) {
+	tour->pathList[i] = malloc(sizeof(Game));
+	tour->pathList[i]->pathFile = paths[i];
+	read_path_file(tour->pathList[i]);
+    }
+}
+
+//Return the roster player in the seat for the round. Each round every
+//player moves up a seat.
+int seat_player(Tournament* tour, int round, int seat) {
+    return (round + seat) % tour->rosterSize;
+}
+
+//Return the round of game number g. The round goes up once every pairing
+//of deck and path has been played.
+int game_round(Tournament* tour, int g) {
+    return g / (tour->decks * tour->pathFiles);
+}
+
+//Create game number g of the tournament, without its players or board.
+//It plays deck g and path g / decks, wrapping around.
+Game* new_game(Tournament* tour, int g) {
+    Game* deck = tour->deckList[g % tour->decks];
+    Game* path = tour->pathList[(g / tour->decks) % tour->pathFiles];
+    Game* game = malloc(sizeof(Game));
+    game->items = deck->items;
+    game->itemDeck = deck->itemDeck;
+    game->paths = path->paths;
+    game->pathsDigits = path->pathsDigits;
+    game->pathDeck = path->pathDeck;
+    game->rawPathDeck = path->rawPathDeck;
+    game->players = tour->seats;
+    game->scoreList = malloc(sizeof(int) * game->players);
+    game->currentItem = 0;
+    game->resultFd = -1;
+    game->keepPlayers = 0;
+    game->broadcast = tour->broadcast;
+    game->broadcastFd = tour->broadcastFd;
+    return game;
+}
+
+//Free a game's board, score list and player list, but not its players
+void free_game(Game* game) {
+    for(int i = 0; i < game->players + 1; i++) {
+	free(game->board[i]);
+    }
+    free(game->board);
+    free(game->playerList);
+    free(game->scoreList);
+    free(game);
+}
+
+//Set up game number g of the tournament with new players
+Game* setup_game(Tournament* tour, int g, int* round) {
+    char* names[tour->seats];
+    Game* game = new_game(tour, g);
+    *round = game_round(tour, g);
+    for(int i = 0; i < tour->seats; i++) {
+	names[i] = tour->roster[seat_player(tour, *round, i)];
+    }
+    init_players(game, names);
+    create_board(game);
+    return game;
+}
+
+//Fork a dealer to play game number g with its output thrown away. It
+//sends the final scores back down a pipe.
+void start_game(Tournament* tour, int g, Running* running) {
+    int result[2];
+    Game* game = setup_game(tour, g, &running->round);
+    if(pipe(result) < 0) {
+	exit_status(BAD_PLAYER);
+    }
+    //so no player holds either end
+    fcntl(result[0], F_SETFD, FD_CLOEXEC);
+    fcntl(result[1], F_SETFD, FD_CLOEXEC);
+    fflush(stdout);
+    running->pid = fork();
+    if(running->pid < 0) {
+	exit_status(BAD_PLAYER);
+    }
+    if(running->pid == 0) {	//We are the game's dealer
+	int file = open("/dev/null", O_WRONLY);
+	dup2(file, STDOUT_FILENO);
+	dup2(file, STDERR_FILENO);
+	close(result[0]);
+	game->resultFd = result[1];
+	if(tour->shared) {
+	    start_broadcast(game);
+	}
+	init_player_process(game, NULL);
+	acknowledge_player(game);
+	game_loop(game);
+	exit_status(NORMAL);
+    }
+    close(result[1]);
+    running->result = result[0];
+    for(int i = 0; i < game->players; i++) {
+	Player* player = game->playerList[i];
+	free(player->plugin);
+	free(player);
+    }
+    free_game(game);
+}
+
+//Set up game number g of the tournament with players from the pool,
+//starting any the pool does not have yet. The pool has a place for each
+//roster player in each seat, as a player's seat is fixed when it starts.
+Game* setup_pooled_game(Tournament* tour, int g, Player** pool) {
+    Game* game = new_game(tour, g);
+    int round = game_round(tour, g);
+    game->keepPlayers = 1;
+    game->playerList = malloc(sizeof(Player*) * game->players);
+    for(int i = 0; i < game->players; i++) {
+	int r = seat_player(tour, round, i);
+	Player** pooled = &pool[r * tour->seats + i];
+	if(!*pooled) {
+	    *pooled = create_player(tour->roster[r], i);
+	    start_player_process(game, *pooled);
+	}
+	reset_player(*pooled);
+	game->playerList[i] = *pooled;
+    }
     create_board(game);
+    watch_players(game);
+    return game;
+}
+
+//Play a lane's games one after another, keeping the players between
+//games. Exiting closes the pooled players' pipes, which ends them.
+void play_lane(Tournament* tour, int first, int result) {
+    Player** pool = calloc(tour->rosterSize * tour->seats, sizeof(Player*));
+    int record[tour->seats + 1];
+    if(tour->shared) {
+	tour->broadcast = create_shared(sizeof(Broadcast), &tour->broadcastFd);
+	if(tour->broadcast == NULL) {
+	    exit_status(BAD_PLAYER);
+	}
+    }
+    for(int g = first; g < tour->games; g += tour->jobs) {
+	Game* game = setup_pooled_game(tour, g, pool);
+	acknowledge_player(game);
+	game_loop(game);
+	record[0] = g;
+	memcpy(record + 1, game->scoreList, sizeof(int) * tour->seats);
+	write(result, record, sizeof(record));
+	close(game->epoll);
+	free_game(game);
+    }
+    exit_status(NORMAL);
+}
+
+//Fork a dealer to play a lane's games from game number first on, with
+//its output thrown away
+void start_lane(Tournament* tour, Lane* lane, int first) {
+    int result[2];
+    if(pipe(result) < 0) {
+	exit_status(BAD_PLAYER);
+    }
+    //so no player holds either end
+    fcntl(result[0], F_SETFD, FD_CLOEXEC);
+    fcntl(result[1], F_SETFD, FD_CLOEXEC);
+    fflush(stdout);
+    lane->pid = fork();
+    if(lane->pid < 0) {
+	exit_status(BAD_PLAYER);
+    }
+    if(lane->pid == 0) {	//We are the lane's dealer
+	int file = open("/dev/null", O_WRONLY);
+	dup2(file, STDOUT_FILENO);
+	dup2(file, STDERR_FILENO);
+	close(result[0]);
+	play_lane(tour, first, result[1]);
+    }
+    close(result[1]);
+    lane->result = result[0];
+    lane->next = first;
+}
+
+//Add the scores of a finished game to the standings of the players in
+//the seats for its round
+void add_scores(Tournament* tour, int round, int* scores) {
+    int best = scores[0];
+    for(int i = 1; i < tour->seats; i++) {
+	if(scores[i] > best) {
+	    best = scores[i];
+	}
+    }
+    for(int i = 0; i < tour->seats; i++) {
+	Standing* standing = &tour->standings[seat_player(tour, round, i)];
+	if(!standing->games || scores[i] > standing->best) {
+	    standing->best = scores[i];
+	}
+	if(!standing->games || scores[i] < standing->worst) {
+	    standing->worst = scores[i];
+	}
+	standing->games++;
+	standing->total = standing->total + scores[i];
+	standing->wins = standing->wins + (scores[i] == best);
+    }
+}
+
+//Add the scores of a game played by a forked dealer to the standings. A
+//game whose dealer did not exit normally is only counted as failed.
+void finish_game(Tournament* tour, Running* running, int status) {
+    int scores[tour->seats];
+    int got = read(running->result, scores, sizeof(scores));
+    close(running->result);
+    running->pid = 0;
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != NORMAL ||
+	    got != sizeof(scores)) {
+	tour->failed++;
+	return;
+    }
+    add_scores(tour, running->round, scores);
 }
 
+//Play the tournament with a dealer and new players forked for every
+//game, up to jobs games at once
+void run_games(Tournament* tour) {
+    Running* running = calloc(tour->jobs, sizeof(Running));
+    int started = 0;
+    int active = 0;
+    while(started < tour->games || active) {
+	for(int i = 0; i < tour->jobs && started < tour->games; i++) {
+	    if(!running[i].pid) {
+		start_game(tour, started++, &running[i]);
+		active++;
+	    }
+	}
+	int status;
+	pid_t pid = wait(&status);
+	for(int i = 0; i < tour->jobs && pid > 0; i++) {
+	    if(running[i].pid == pid) {
+		finish_game(tour, &running[i], status);
+		active--;
+	    }
+	}
+    }
+    free(running);
+}
+
+//Play the tournament on jobs lanes that each keep a pool of players
+//between games. A lane that dies counts the game it was playing as
+//failed and is started again from its next game.
+void run_lanes(Tournament* tour) {
+    Lane* lanes = calloc(tour->jobs, sizeof(Lane));
+    struct pollfd* polls = malloc(sizeof(struct pollfd) * tour->jobs);
+    int record[tour->seats + 1];
+    int active = 0;
+    for(int i = 0; i < tour->jobs && i < tour->games; i++) {
+	start_lane(tour, &lanes[i], i);
+	active++;
+    }
+    while(active) {
+	for(int i = 0; i < tour->jobs; i++) {
+	    polls[i].fd = lanes[i].pid ? lanes[i].result : -1;
+	    polls[i].events = POLLIN;
+	}
+	if(poll(polls, tour->jobs, -1) <= 0) {
+	    continue;
+	}
+	for(int i = 0; i < tour->jobs; i++) {
+	    Lane* lane = &lanes[i];
+	    if(!lane->pid || !polls[i].revents) {
+		continue;
+	    }
+	    if(read(lane->result, record, sizeof(record)) == sizeof(record)) {
+		add_scores(tour, game_round(tour, record[0]), record + 1);
+		lane->next = record[0] + tour->jobs;
+		continue;
+	    }
+	    close(lane->result);
+	    waitpid(lane->pid, NULL, 0);
+	    lane->pid = 0;
+	    active--;
+	    if(lane->next < tour->games) {
+		tour->failed++;
+		if(lane->next + tour->jobs < tour->games) {
+		    start_lane(tour, lane, lane->next + tour->jobs);
+		    active++;
+		}
+	    }
+	}
+    }
+    free(polls);
+    free(lanes);
+}
+
+//Print how each roster player did and how fast the games were played
+void print_standings(Tournament* tour, long millis) {
+    double seconds = millis / 1000.0;
+    fprintf(stdout, "Tournament: %d games, %d failed, %.3fs, %.1f games/s\n",
+	    tour->games, tour->failed, seconds,
+	    seconds > 0 ? tour->games / seconds : 0.0);
+    for(int i = 0; i < tour->rosterSize; i++) {
+	Standing* standing = &tour->standings[i];
+	fprintf(stdout, "%s: games=%d wins=%d mean=%.2f min=%d max=%d\n",
+		tour->roster[i], standing->games, standing->wins,
+		standing->games ? (double)standing->total / standing->games :
+		0.0, standing->worst, standing->best);
+    }
+}
+
+//Play a tournament, with up to jobs games running at once; one job plays
+//the games one after another. Ties for the highest score are a win for
+//every player in them. With -w each job keeps its players running from
+//one game to the next, so every roster player must understand NEXT. With
+//-s player processes talk to the dealer over shared memory rings.
+//  2310dealer -t games jobs seats [-w] [-s] -d deck... -p path...
+//	    -r player...
+void run_tournament(int argc, char** argv) {
+    Tournament tour;
+    char** decks;
+    char** paths;
+    int next = 5;
+    if(argc < 11) {
+	exit_status(TOURNAMENT_ARGS);
+    }
+    tour.games = tournament_number(argv[2], 1, 1 << 30);
+    tour.jobs = tournament_number(argv[3], 1, 1024);
+    tour.seats = tournament_number(argv[4], 1, 9);
+    tour.pool = !strcmp(argv[next], "-w");
+    next = next + tour.pool;
+    tour.shared = !strcmp(argv[next], "-s");
+    next = next + tour.shared;
+    tour.decks = tournament_list(argc, argv, &next, "-d", &decks);
+    tour.pathFiles = tournament_list(argc, argv, &next, "-p", &paths);
+    tour.rosterSize = tournament_list(argc, argv, &next, "-r",
+	    &tour.roster);
+    if(next != argc) {
+	exit_status(TOURNAMENT_ARGS);
+    }
+    tour.standings = calloc(tour.rosterSize, sizeof(Standing));
+    tour.failed = 0;
+    tour.broadcast = NULL;
+    read_tournament_files(&tour, decks, paths);
+    long start = now_millis();
+    if(tour.pool) {
+	run_lanes(&tour);
+    } else {
+	run_games(&tour);
+    }
+    print_standings(&tour, now_millis() - start);
+    exit_status(NORMAL);
+}
+
+//Play one game. A leading -s has the player processes talk to the dealer
+//over shared memory rings instead of pipes.
 int main(int argc, char** argv) {
+    int shared = argc > 1 && !strcmp(argv[1], "-s");
+    if(argc > 1 && !strcmp(argv[1], "-t")) {
+	run_tournament(argc, argv);
+    }
     Game* game = malloc(sizeof(Game));
-    validate_arguements(game, argc, argv);
+    validate_arguements(game, argc - shared, argv + shared);
+    if(shared) {
+	start_broadcast(game);
+    }
     init_player_process(game, argv);
     acknowledge_player(game);
     game_loop(game);
+    exit_status(NORMAL);
     return 1;
 }
@@ -0,0 +1,469 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <setjmp.h>
+#include "player.h"
+#include "common.h"
+
+//Where exit_status goes back to while the player runs as a plugin inside
+//the dealer, or NULL when the player is its own process
+jmp_buf* escape = NULL;
+
+//Exit status method. Will print error to stderr and exit. A plugin
+//instead goes back to the callback it is in, which reports the error.
+Status exit_status(Status s) {
+    if(escape) {
+	longjmp(*escape, 1);
+    }
+    const char* message[] = {"",
+	    "Usage: player pcount ID",
+	    "Invalid player count",
+	    "Invalid ID",
+	    "Invalid path",
+	    "Early game over",
+	    "Communications error"};
+    fprintf(stderr, "%s", message[s]);
+    fprintf(stderr, "\n");
+    exit(s);
+}
+
+//Read the next message from the dealer into buffer like fgets, from the
+//ring transport if the dealer started the player with one. fresh is set
+//while waiting for the path deck of a game.
+char* read_line(Player* player, char* buffer, int size, int fresh) {
+    if(player->link) {
+	return link_gets(player->link, buffer, size, fresh);
+    }
+    return fgets(buffer, size, stdin);
+}
+
+//Send text to the dealer
+void send_text(Player* player, const char* text) {
+    if(player->link) {
+	link_write(player->link, text);
+	return;
+    }
+    fputs(text, stdout);
+    fflush(stdout);
+}
+
+//Count how many rows contain a char. Return the count.
+int char_on_row(Player* player) {
+    int k = 0;
+    for(int i = 0; i < player->ptotal + 1; i++) {
+	for(int j = 0; j < player->paths * 3; j++) {
+	    if(player->board[i][j] != ' ') {
+		k = i;
+	    }
+	}
+    }
+    return k + 1;
+}
+
+//Print the board. The board will only print rows that have
+//sites ore players id's store on them. char_on_row() will
+//provide the count for how many rows need to be print.
+void print_board(Player* player) {
+    if(player->quiet) {
+	return;
+    }
+    int c = char_on_row(player);
+    int k = 1;
+    for(int i = 0; i < c; i++) {
+	for(int j = 0; j < player->paths * 3; j++) {
+	    if(i == 0 && k % 3 == 0) {
+		fprintf(stderr, " ");
+	    } else {
+		fprintf(stderr, "%c", player->board[i][j]);
+	    }
+	    k++;
+	}
+	fprintf(stderr, "\n");
+    }
+}
+
+//Check the validity of the sites. If a sites is invalid
+//exit the game.
+void check_site(char* site) {
+    if(site[2] != '-') {
+	if(!isdigit(site[2])) {
+	    exit_status(INVALID_PATH);
+	}
+    }
+    if(site[0] == 'M' && site[1] == 'o') {
+	return;
+    } else if(site[0] == 'V' && (site[1] == '1' || site[1] == '2')) {
+	return;
+    } else if(site[0] == 'D' && site[1] == 'o') {
+	return;
+    } else if(site[0] == 'R' && site[1] == 'i') {
+	return;
+    } else if(site[0] == ':' && site[1] == ':' && site[2] == '-') {
+	return;
+    } else {
+	exit_status(INVALID_PATH);
+    }
+}
+
+//Check the path deck to ensure content are valid.
+void check_path_deck(Player* player) {
+    int paths = player->paths * 3;
+    char* site = malloc(sizeof(char) * 3);
+    char si, te, siteLimit;
+    int digits = player->pathsDigits;
+    for(int i = 0; i < paths; i++) {
+	if((i == 0 || i == 1 || i == (paths - 2) || i == (paths - 3)) &&
+		player->pathDeck[i] != ':') {
+	    exit_status(INVALID_PATH);
+	}
+	if(i % 3 == 0 && i > digits + 3) {
+	    si = player->pathDeck[i];
+	    te = player->pathDeck[i + 1];
+	    siteLimit = player->pathDeck[i + 2];
+	    sprintf(site, "%c%c%c", si, te, siteLimit);
+	    check_site(site);
+	}
+    }
+}
+
+//Read the path deck from the dealer. Deck variables will be checked for
+//validity.
+void read_path_deck(Player* player) {
+    char buffer[1024];
+    if(!read_line(player, buffer, 1024, 1)) {
+	exit_status(INVALID_PATH);
+    }
+    parse_path_deck(player, buffer);
+}
+
+//Store the path deck in buffer to the player struct and check it
+void parse_path_deck(Player* player, char buffer[]) {
+    int paths = 0;
+    char* err;
+    for(int i = 0; i < 1024; i++) {
+	if(buffer[i] == ';' && paths == 0) {
+	    paths = i;
+	}
+    }
+    player->pathsDigits = paths;
+    char pathsCopy[player->pathsDigits];
+    strncpy(pathsCopy, buffer, player->pathsDigits);
+    pathsCopy[player->pathsDigits] = '\0';
+    player->paths = strtoul(pathsCopy, &err, 10);
+    if(player->paths < 2) {
+	exit_status(INVALID_PATH);
+    }
+    player->pathsDigits = player->pathsDigits + 1;
+    player->pathDeck = malloc(sizeof(char) * 
+	    (player->paths * 3) + player->pathsDigits);
+    for(int i = 0; i < player->paths * 3 + player->pathsDigits; i++) {
+	player->pathDeck[i] = buffer[i + player->pathsDigits];
+    }
+    check_path_deck(player);
+    create_board(player);
+}
+
+//Create the game board. The board will be created using the path
+//file. The population or '-' char of each site or barrier will be 
+//replaced with ' '. Players will start on the board represented by their
+//id's in decending order.
+void create_board(Player* player) {
+    player->board = malloc(sizeof(char*) * (player->ptotal + 1));
+    for(int i = 0; i < player->ptotal + 1; i++) {
+	player->board[i] = malloc(sizeof(char) * (player->paths * 3));
+    }
+    for(int i = 0; i < player->ptotal + 1; i++) {
+	for(int j = 0; j < player->paths * 3; j++) {
+	    if(i != 0 && j == 0) {
+		player->board[i][j] = 
+			player->playerIDList[player->ptotal - i] + '0';
+	    } else if(i == 0) {
+		player->board[i][j] = player->pathDeck[j];
+	    } else if(i != 0 && j != 0) {
+		player->board[i][j] = ' ';
+	    }
+	}
+    }
+}
+
+//Setup the item list for all players. Items are stored in a 2x2
+//array as such.
+//  list[i][0] = A
+//  list[i][1] = B
+//  .
+//  .
+//  .
+//  list[i][4] = E
+void setup_item_array(Player* player) {
+    player->playerItems = malloc(sizeof(int*) * player->ptotal);
+    for(int i = 0; i < player->ptotal; i++) {
+	player->playerItems[i] = malloc(sizeof(int) * 5);
+	for(int j = 0; j < 5; j++) {
+	    player->playerItems[i][j] = 0;
+	}
+    }
+}
+
+//Return the population of the given site.
+int get_site_pop(Player* player, int j) {
+    int pop = 0;
+    for(int i = 1; i < player->ptotal + 1; i++) {
+	if(player->board[i][j] != ' ') {
+	    pop++;
+	}
+    }
+    return pop;
+}
+
+//Add items to the last.
+void add_item_to_list(Player* player, char id, int item) {
+    int i = id - '0';
+    int j = item - 1;
+    player->playerItems[i][j] = player->playerItems[i][j] + 1;
+}
+
+//Print the players updated variables to stderr.
+void print_player_update(Player* player, int i) {
+    if(player->quiet) {
+	return;
+    }
+    int id = player->playerIDList[i];
+    int money = player->playerMoney[i];
+    int v1 = player->vScores[i][0];
+    int v2 = player->vScores[i][1];
+    int points = player->playerPoints[i];
+    int a = player->playerItems[i][0];
+    int b = player->playerItems[i][1];
+    int c = player->playerItems[i][2];
+    int d = player->playerItems[i][3];
+    int e = player->playerItems[i][4];
+    fprintf(stderr, "Player %d Money=%d V1=%d V2=%d Points=%d ",
+	    id, money, v1, v2, points);
+    fprintf(stderr, "A=%d B=%d C=%d D=%d E=%d\n", a, b, c, d, e);
+}
+
+//Update the board. The update is based off the HAP message and not
+//the site the player lands on.
+void update_player_board(Player* player, char rxMsg[]) {
+    int n, s, m, c;
+    char p;
+    if(sscanf(rxMsg, "HAP%c,%d,%d,%d,%d\n", &p, &n, &s, &m, &c) != 5) {
+	exit_status(COMM_ERROR);
+    }
+    apply_hap(player, p, n, s, m, c);
+}
+
+//Send the move DO message to the hub
+void send_move(Player* player) {
+    char move[16];
+    sprintf(move, "DO%d\n", choose_move(player));
+    send_text(player, move);
+}
+
+//Check if the game has ended. The game ends when all plaeyrs
+//are located on the final site
+int is_game_over(Player* player) {
+    int endGame = 1;
+    int j = ((player->paths * 3) - 3);
+    for(int i = 1; i < player->ptotal + 1; i++) {
+	if(player->board[i][j] == ' ') {
+	    endGame = 0;
+	}
+    }
+    return endGame;
+}
+
+//Clear the variables of every player for another game. The board and
+//path deck are freed; the next path deck makes new ones.
+void reset_player(Player* player) {
+    for(int i = 0; i < player->ptotal + 1; i++) {
+	free(player->board[i]);
+    }
+    free(player->board);
+    free(player->pathDeck);
+    for(int i = 0; i < player->ptotal; i++) {
+	player->playerScore[i] = 0;
+	player->playerPoints[i] = 0;
+	player->playerMoney[i] = 7;
+	player->vScores[i][0] = 0;
+	player->vScores[i][1] = 0;
+	for(int j = 0; j < 5; j++) {
+	    player->playerItems[i][j] = 0;
+	}
+    }
+    player->sitesVisited[0] = 0;
+    player->sitesVisited[1] = 0;
+    player->currentRow = 0;
+    player->currentCol = 0;
+}
+
+//Get ready for another game after NEXT. The player acknowledges again
+//and reads the next path deck. The dealer closing the pipe instead means
+//there are no more games; a ring player is ended by the dealer exiting.
+void next_game(Player* player) {
+    reset_player(player);
+    send_text(player, "^");
+    if(!player->link) {
+	int next = getc(stdin);
+	if(next == EOF) {
+	    exit_status(NORMAL);
+	}
+	ungetc(next, stdin);
+    }
+    read_path_deck(player);
+    print_board(player);
+}
+
+//Create the score list to store the players score
+void create_score_list(Player* player) {
+    player->playerScore = malloc(sizeof(int) * player->ptotal);
+    for(int i = 0; i < player->ptotal; i++) {
+	player->playerScore[i] = 0;
+    }
+}
+
+//Create the vcore list to store v sites that player has landed on
+void create_vscore_list(Player* player) {
+    player->vScores = malloc(sizeof(int*) * player->ptotal);
+    for(int i = 0; i < player->ptotal; i++) {
+	player->vScores[i] = malloc(sizeof(int) * 2);
+	for(int j = 0; j < 2; j++) {
+	    player->vScores[i][j] = 0;
+	}
+    }
+}
+
+//Create the point list to store players points from Do sites
+void create_points_list(Player* player) {
+    player->playerPoints = malloc(sizeof(int) * player->ptotal);
+    for(int i = 0; i < player->ptotal; i++) {
+	player->playerPoints[i] = 0;
+    }
+}
+
+//Create the money list to store players money 
+void create_money_list(Player* player) {
+    player->playerMoney = malloc(sizeof(int) * player->ptotal);
+    for(int i = 0; i < player->ptotal; i++) {
+	player->playerMoney[i] = 7;
+    }
+}
+
+//Create the ID list to store players ID
+void create_id_list(Player* player) {
+    player->playerIDList = malloc(sizeof(int) * player->ptotal);
+    for(int i = 0; i < player->ptotal; i++) {
+	player->playerIDList[i] = i;
+    }
+}
+
+//Create the lists of every player's variables and start the player at
+//the beginning of the path
+void create_lists(Player* player) {
+    create_score_list(player);
+    create_id_list(player);
+    create_money_list(player);
+    create_points_list(player);
+    create_vscore_list(player);
+    player->currentRow = 0;
+    player->currentCol = 0;
+    setup_item_array(player);
+    player->sitesVisited = malloc(sizeof(int) * 2);
+    player->sitesVisited[0] = 0;
+    player->sitesVisited[1] = 0;
+}
+
+//Start the player. Initilise variables for the player and create lists
+//for other players variables to store.
+void start_player(Player* player, int argc, char** argv) {
+    player->quiet = 0;
+    initialise_variables(player, argc, argv);
+    player->link = open_link();
+    send_text(player, "^");
+    read_path_deck(player);    
+    print_board(player);
+    read_message(player);
+}
+
+//Free the player and every list of its variables
+void free_player(Player* player) {
+    for(int i = 0; i < player->ptotal + 1; i++) {
+	free(player->board[i]);
+    }
+    free(player->board);
+    free(player->pathDeck);
+    for(int i = 0; i < player->ptotal; i++) {
+	free(player->vScores[i]);
+	free(player->playerItems[i]);
+    }
+    free(player->vScores);
+    free(player->playerItems);
+    free(player->playerScore);
+    free(player->playerPoints);
+    free(player->playerIDList);
+    free(player->playerMoney);
+    free(player->sitesVisited);
+    free(player);
+}
+
+//Plugin callback for the path deck. Create a quiet player for the game
+//the way start_player does for a process.
+void* on_path(int players, int id, const char* path) {
+    jmp_buf here;
+    char buffer[1024] = {0};
+    Player* player = malloc(sizeof(Player));
+    if(setjmp(here)) {
+	escape = NULL;
+	return NULL;
+    }
+    escape = &here;
+    player->ptotal = players;
+    player->id = id;
+    player->quiet = 1;
+    player->link = NULL;
+    create_lists(player);
+    strncpy(buffer, path, 1023);
+    parse_path_deck(player, buffer);
+    escape = NULL;
+    return player;
+}
+
+//Plugin callback for a HAP message
+int on_hap(void* state, int p, int n, int s, int m, int c) {
+    jmp_buf here;
+    if(setjmp(here)) {
+	escape = NULL;
+	return 0;
+    }
+    escape = &here;
+    apply_hap(state, p + '0', n, s, m, c);
+    escape = NULL;
+    return 1;
+}
+
+//Plugin callback for YT
+int on_your_turn(void* state) {
+    jmp_buf here;
+    if(setjmp(here)) {
+	escape = NULL;
+	return -1;
+    }
+    escape = &here;
+    int site = choose_move(state);
+    escape = NULL;
+    return site;
+}
+
+//Plugin callback for the end of the game
+void on_done(void* state) {
+    free_player(state);
+}
+
+#ifndef PLUGIN
+int main(int argc, char** argv) {
+    Player* player = malloc(sizeof(Player));
+    start_player(player, argc, argv);
+    return 1;
+}
+#endif
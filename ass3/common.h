@@ -0,0 +1,65 @@
+#ifndef COMMON_H
+#define COMMON_H
+
+#include "ring.h"
+
+//The parts of a player that do not depend on its strategy, shared by
+//2310A and 2310B. Each is built from common.c and its own strategy file.
+
+typedef struct Player {
+    char* name;
+    char* pathDeck;
+    char** board;
+    int paths;
+    int ptotal;
+    int id;
+    int currentRow;
+    int currentCol;
+    int pathsDigits;
+    int quiet;
+    Link* link;
+    int* playerScore;
+    int* playerPoints;
+    int* sitesVisited;
+    int* playerIDList;
+    int* playerMoney;
+    int** playerItems;
+    int** vScores;
+} Player;
+
+typedef enum {
+    NORMAL = 0,
+    INVALID_ARGS = 1,
+    INVALID_PCOUNT = 2,
+    INVALID_ID = 3,
+    INVALID_PATH = 4,
+    EOG = 5,
+    COMM_ERROR = 6
+} Status;
+
+//common.c
+Status exit_status(Status s);
+char* read_line(Player* player, char* buffer, int size, int fresh);
+void send_text(Player* player, const char* text);
+void print_board(Player* player);
+void read_path_deck(Player* player);
+void parse_path_deck(Player* player, char buffer[]);
+void create_board(Player* player);
+int get_site_pop(Player* player, int j);
+void add_item_to_list(Player* player, char id, int item);
+void print_player_update(Player* player, int i);
+void update_player_board(Player* player, char rxMsg[]);
+void send_move(Player* player);
+int is_game_over(Player* player);
+void next_game(Player* player);
+void create_lists(Player* player);
+void start_player(Player* player, int argc, char** argv);
+
+//Each player's strategy file
+void apply_hap(Player* player, char p, int n, int s, int m, int c);
+int choose_move(Player* player);
+void do_score(Player* player);
+void read_message(Player* player);
+void initialise_variables(Player* player, int argc, char** argv);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+//The callbacks a player strategy built as a shared object exports, so
+//2310dealer can play it inside its own process instead of over pipes.
+//Each stands in for a message of the pipe protocol:
+//  on_path	    the path deck. Return the player's state for the game, or
+//		    NULL if the path is not valid.
+//  on_hap	    a HAP message, player p moved to site n, got s points, m
+//		    money and item c. Return 0 if it is not valid.
+//  on_your_turn    YT. Return the site to move to, as sent in DO, or -1 on
+//		    an error.
+//  on_done	    DONE or NEXT. Free the player's state.
+typedef void* (*PathCallback)(int players, int id, const char* path);
+typedef int (*HapCallback)(void* state, int p, int n, int s, int m, int c);
+typedef int (*TurnCallback)(void* state);
+typedef void (*DoneCallback)(void* state);
+
+#endif
@@ -0,0 +1,216 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include "ring.h"
+
+#define RING_MASK (RING_BYTES - 1)
+
+//Copy length bytes into a ring's data from position at on, wrapping round
+//its end
+void copy_in(char* data, uint32_t at, const void* from, uint32_t length) {
+    uint32_t start = at & RING_MASK;
+    uint32_t first = length < RING_BYTES - start ? length : RING_BYTES - start;
+    memcpy(data + start, from, first);
+    memcpy(data, (const char*)from + first, length - first);
+}
+
+//Copy length bytes out of a ring's data from position at on, wrapping
+//round its end
+void copy_out(void* to, const char* data, uint32_t at, uint32_t length) {
+    uint32_t start = at & RING_MASK;
+    uint32_t first = length < RING_BYTES - start ? length : RING_BYTES - start;
+    memcpy(to, data + start, first);
+    memcpy((char*)to + first, data, length - first);
+}
+
+//Copy the line at head out of a ring's data into buffer like fgets, up to
+//tail at most. Return the position after it.
+uint32_t take_line(const char* data, uint32_t head, uint32_t tail,
+	char* buffer, int size) {
+    int length = 0;
+    while(head != tail && length < size - 1) {
+	char c = data[head++ & RING_MASK];
+	buffer[length++] = c;
+	if(c == '\n') {
+	    break;
+	}
+    }
+    buffer[length] = '\0';
+    return head;
+}
+
+//Return the number of times a doorbell has been rung
+uint32_t read_bell(uint32_t* bell) {
+    return __atomic_load_n(bell, __ATOMIC_SEQ_CST);
+}
+
+//Ring a doorbell, waking its reader only if it is asleep
+void ring_bell(uint32_t* bell, uint32_t* sleeping) {
+    __atomic_add_fetch(bell, 1, __ATOMIC_SEQ_CST);
+    if(__atomic_load_n(sleeping, __ATOMIC_SEQ_CST)) {
+	syscall(SYS_futex, bell, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+}
+
+//Sleep until the doorbell has been rung since it was read as seen, or for
+//at most millis milliseconds unless millis is negative
+void wait_bell(uint32_t* bell, uint32_t* sleeping, uint32_t seen,
+	long millis) {
+    struct timespec timeout = {millis / 1000, (millis % 1000) * 1000000};
+    __atomic_store_n(sleeping, 1, __ATOMIC_SEQ_CST);
+    syscall(SYS_futex, bell, FUTEX_WAIT, seen, millis < 0 ? NULL : &timeout,
+	    NULL, 0);
+    __atomic_store_n(sleeping, 0, __ATOMIC_SEQ_CST);
+}
+
+//Create zeroed shared memory of the given size that a player started
+//later can map from fd. Return NULL if it can't be created.
+void* create_shared(int size, int* fd) {
+    *fd = memfd_create("2310ring", MFD_CLOEXEC);
+    if(*fd < 0) {
+	return NULL;
+    }
+    void* map = MAP_FAILED;
+    if(ftruncate(*fd, size) == 0) {
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    }
+    if(map == MAP_FAILED) {
+	close(*fd);
+	return NULL;
+    }
+    return map;
+}
+
+//Send a message to a ring player. Return 0 if its ring has no room.
+int channel_send(Channel* channel, Broadcast* broadcast, const char* text) {
+    Ring* ring = &channel->toPlayer;
+    uint32_t header[2] = {broadcast->tail, strlen(text)};
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if(RING_BYTES - (tail - head) < sizeof(header) + header[1]) {
+	return 0;
+    }
+    copy_in(ring->data, tail, header, sizeof(header));
+    copy_in(ring->data, tail + sizeof(header), text, header[1]);
+    __atomic_store_n(&ring->tail, tail + sizeof(header) + header[1],
+	    __ATOMIC_RELEASE);
+    ring_bell(&channel->playerBell, &channel->playerSleeping);
+    return 1;
+}
+
+//Write a message once for every reader of the broadcast ring. Return 0 if
+//the reader furthest behind has not left room for it.
+int broadcast_send(Broadcast* broadcast, Channel** readers, int count,
+	const char* text) {
+    uint32_t length = strlen(text);
+    uint32_t tail = broadcast->tail;
+    for(int i = 0; i < count; i++) {
+	uint32_t head = __atomic_load_n(&readers[i]->broadcastHead,
+		__ATOMIC_ACQUIRE);
+	if(RING_BYTES - (tail - head) < length) {
+	    return 0;
+	}
+    }
+    copy_in(broadcast->data, tail, text, length);
+    __atomic_store_n(&broadcast->tail, tail + length, __ATOMIC_RELEASE);
+    for(int i = 0; i < count; i++) {
+	ring_bell(&readers[i]->playerBell, &readers[i]->playerSleeping);
+    }
+    return 1;
+}
+
+//Move up to size bytes the player has written to the dealer into buffer.
+//Return the number moved.
+int channel_receive(Channel* channel, char* buffer, int size) {
+    Ring* ring = &channel->toDealer;
+    uint32_t head = ring->head;
+    uint32_t count = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - head;
+    if(count > size) {
+	count = size;
+    }
+    copy_out(buffer, ring->data, head, count);
+    __atomic_store_n(&ring->head, head + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+//Map a ring player's channel and the broadcast ring from the descriptors
+//in PLAYER_RING, which the dealer sets as "channel,broadcast". Return NULL
+//if it is not set, and the player talks over stdin and stdout.
+Link* open_link(void) {
+    char* rings = getenv("PLAYER_RING");
+    int channelFd;
+    int broadcastFd;
+    if(rings == NULL ||
+	    sscanf(rings, "%d,%d", &channelFd, &broadcastFd) != 2) {
+	return NULL;
+    }
+    void* channel = mmap(NULL, sizeof(Channel), PROT_READ | PROT_WRITE,
+	    MAP_SHARED, channelFd, 0);
+    void* broadcast = mmap(NULL, sizeof(Broadcast), PROT_READ | PROT_WRITE,
+	    MAP_SHARED, broadcastFd, 0);
+    close(channelFd);
+    close(broadcastFd);
+    if(channel == MAP_FAILED || broadcast == MAP_FAILED) {
+	return NULL;
+    }
+    Link* link = malloc(sizeof(Link));
+    link->channel = channel;
+    link->broadcast = broadcast;
+    return link;
+}
+
+//Read the next message from the dealer into buffer like fgets, sleeping
+//until there is one. Broadcasts sent before a message to this player are
+//read before it. A fresh player is waiting for a game to start, so it
+//skips the broadcasts of games it was not in.
+char* link_gets(Link* link, char* buffer, int size, int fresh) {
+    Channel* channel = link->channel;
+    Ring* ring = &channel->toPlayer;
+    while(1) {
+	uint32_t seen = read_bell(&channel->playerBell);
+	uint32_t tail = __atomic_load_n(&link->broadcast->tail,
+		__ATOMIC_ACQUIRE);
+	uint32_t head = channel->broadcastHead;
+	if(__atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) != ring->head) {
+	    uint32_t header[2];
+	    copy_out(header, ring->data, ring->head, sizeof(header));
+	    if(fresh || head == header[0]) {
+		uint32_t start = ring->head + sizeof(header);
+		__atomic_store_n(&channel->broadcastHead, header[0],
+			__ATOMIC_RELEASE);
+		take_line(ring->data, start, start + header[1], buffer, size);
+		__atomic_store_n(&ring->head, start + header[1],
+			__ATOMIC_RELEASE);
+		return buffer;
+	    }
+	    tail = header[0];
+	}
+	if(!fresh && head != tail) {
+	    head = take_line(link->broadcast->data, head, tail, buffer, size);
+	    __atomic_store_n(&channel->broadcastHead, head, __ATOMIC_RELEASE);
+	    return buffer;
+	}
+	wait_bell(&channel->playerBell, &channel->playerSleeping, seen, -1);
+    }
+}
+
+//Send text to the dealer and ring its doorbell. The ring is only too full
+//to take it if the dealer has stopped reading, so just wait for room.
+void link_write(Link* link, const char* text) {
+    Ring* ring = &link->channel->toDealer;
+    uint32_t length = strlen(text);
+    uint32_t tail = ring->tail;
+    while(RING_BYTES - (tail - __atomic_load_n(&ring->head,
+	    __ATOMIC_ACQUIRE)) < length) {
+	usleep(1000);
+    }
+    copy_in(ring->data, tail, text, length);
+    __atomic_store_n(&ring->tail, tail + length, __ATOMIC_RELEASE);
+    ring_bell(&link->broadcast->dealerBell, &link->broadcast->dealerSleeping);
+}
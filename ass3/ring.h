@@ -0,0 +1,62 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdint.h>
+
+//Bytes in a ring, a power of two
+#define RING_BYTES (1 << 16)
+
+//A single producer, single consumer ring of bytes in shared memory. Only
+//the producer moves tail and only the consumer moves head. Both count the
+//bytes written or read and wrap at 2^32, so tail - head bytes are waiting.
+typedef struct Ring {
+    uint32_t head;
+    uint32_t tail;
+    char data[RING_BYTES];
+} Ring;
+
+//The ring every ring player of a dealer reads HAP messages from, and the
+//doorbell the players ring when they write to the dealer. A doorbell
+//counts writes and is the futex its reader sleeps on while it has nothing
+//to read.
+typedef struct Broadcast {
+    uint32_t tail;
+    uint32_t dealerBell;
+    uint32_t dealerSleeping;
+    char data[RING_BYTES];
+} Broadcast;
+
+//The shared memory of one ring player: a ring each way, the player's read
+//position in the broadcast ring and its doorbell. Each message to the
+//player starts with the broadcast tail when it was sent and its length,
+//so the player reads the broadcasts sent before it first.
+typedef struct Channel {
+    Ring toPlayer;
+    Ring toDealer;
+    uint32_t broadcastHead;
+    uint32_t playerBell;
+    uint32_t playerSleeping;
+} Channel;
+
+//A ring player's end of the transport
+typedef struct Link {
+    Channel* channel;
+    Broadcast* broadcast;
+} Link;
+
+//Dealer end
+void* create_shared(int size, int* fd);
+int channel_send(Channel* channel, Broadcast* broadcast, const char* text);
+int broadcast_send(Broadcast* broadcast, Channel** readers, int count,
+	const char* text);
+int channel_receive(Channel* channel, char* buffer, int size);
+void wait_bell(uint32_t* bell, uint32_t* sleeping, uint32_t seen,
+	long millis);
+uint32_t read_bell(uint32_t* bell);
+
+//Player end
+Link* open_link(void);
+char* link_gets(Link* link, char* buffer, int size, int fresh);
+void link_write(Link* link, const char* text);
+
+#endif